@@ -1,4 +1,12 @@
 #include "cubemap.h"
+#include <cmath>
+#include <cstring>
+
+static unsigned int getNewContentsStamp(void)
+{
+	static std::atomic<unsigned int> lastContentsStamp(0);
+	return ++lastContentsStamp;
+}
 
 CubeMap::CubeMap(const string & texFilename)
 {
@@ -10,71 +18,60 @@ CubeMap::CubeMap(const string & texFilename)
 	cubeMapFacesCams = new PPC*[envMapN];
 	cubeMapFaces = new Texture*[envMapN];
 
-	for (unsigned int i = 0; i < envMapN; i++) {
-		cubeMapFacesCams[i] = new PPC(90.0f, envMapResWidth, envMapResHeight);
-	}
-
-	// build the cube map's six faces and cameras
+	// build the cube map's six faces
 	cubeMapFaces[0] = new Texture(masterTexObject,
 		2 * envMapResWidth, 3 * envMapResWidth,
 		1 * envMapResHeight, 2 * envMapResHeight);
-	cubeMapFacesCams[0]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(1.0f, 0.0f, 0.0f), // look at pos x direction
-		V3(0.0f, 1.0f, 0.0f),
-		0.0f);
 
 	cubeMapFaces[1] = new Texture(masterTexObject,
 		0 * envMapResWidth, 1 * envMapResWidth,
 		1 * envMapResHeight, 2 * envMapResHeight);
-	cubeMapFacesCams[1]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(-1.0f, 0.0f, 0.0f), // look at neg x direction
-		V3(0.0f, 1.0f, 0.0f),
-		0.0f);
 	
 	cubeMapFaces[2] = new Texture(masterTexObject,
 		1 * envMapResWidth, 2 * envMapResWidth,
 		3 * envMapResHeight, 4 * envMapResHeight);
 	cubeMapFaces[2]->flipAboutX();
 	cubeMapFaces[2]->flipAboutY();
-	cubeMapFacesCams[2]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(0.0f, 0.0f, 1.0f), // look at neg z direction
-		V3(0.0f, 1.0f, 0.0f),
-		0.0f);
 
 	cubeMapFaces[3] = new Texture(masterTexObject,
 		1 * envMapResWidth, 2 * envMapResWidth,
 		1 * envMapResHeight, 2 * envMapResHeight);
-	cubeMapFacesCams[3]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(0.0f, 0.0f, -1.0f), // look at pos z direction
-		V3(0.0f, 1.0f, 0.0f),
-		0.0f);
 
 	cubeMapFaces[4] = new Texture(masterTexObject,
 		1 * envMapResWidth, 2 * envMapResWidth,
 		0 * envMapResHeight, 1 * envMapResHeight);
-	cubeMapFacesCams[4]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(0.0f, 1.0f, 0.0f), // look at pos y direction
-		V3(0.0f, 0.0f, 1.0f),
-		0.0f);
 
 	cubeMapFaces[5] = new Texture(masterTexObject,
 		1 * envMapResWidth, 2 * envMapResWidth,
 		2 * envMapResHeight, 3 * envMapResHeight);
-	cubeMapFacesCams[5]->positionRelativeToPoint(
-		V3(0.0f, 0.0f, 0.0f),
-		V3(0.0f, -1.0f, 0.0f), // look at neg y direction
-		V3(0.0f, 0.0f, 1.0f),
-		0.0f);
+
+	// and the cameras looking at them from the center
+	const V3 viewDirs[6] = {
+		V3(1.0f, 0.0f, 0.0f), // pos x
+		V3(-1.0f, 0.0f, 0.0f), // neg x
+		V3(0.0f, 0.0f, 1.0f), // pos z (the flipped bottom part of the cross)
+		V3(0.0f, 0.0f, -1.0f), // neg z
+		V3(0.0f, 1.0f, 0.0f), // pos y
+		V3(0.0f, -1.0f, 0.0f) // neg y
+	};
+	const V3 ups[6] = {
+		V3(0.0f, 1.0f, 0.0f), V3(0.0f, 1.0f, 0.0f), V3(0.0f, 1.0f, 0.0f),
+		V3(0.0f, 1.0f, 0.0f), V3(0.0f, 0.0f, 1.0f), V3(0.0f, 0.0f, 1.0f)
+	};
+	for (unsigned int i = 0; i < envMapN; i++) {
+		cubeMapFacesCams[i] = new PPC(90.0f, envMapResWidth, envMapResHeight);
+		cubeMapFacesCams[i]->positionRelativeToPoint(V3(0.0f, 0.0f, 0.0f), viewDirs[i], ups[i], 0.0f);
+		// same axes positionRelativeToPoint gives the camera
+		faceViewDirs[i] = viewDirs[i];
+		faceAs[i] = (viewDirs[i] ^ ups[i]).getNormalized();
+		faceBs[i] = (viewDirs[i] ^ faceAs[i]).getNormalized();
+	}
 
 	// its the same for all cameras so it doesn't matter who
 	// supplies this value here.
 	cubeMapFocalLength = cubeMapFacesCams[0]->getFocalLength();
 	currentLookAtFace = 0;
+	contentsStamp = getNewContentsStamp();
 }
 
 
@@ -96,19 +93,106 @@ Texture * CubeMap::getCubeFace(unsigned int i) const
 		return cubeMapFaces[i];
 }
 
+void CubeMap::setIsProjectionLookupOn(bool isOn)
+{
+	if (isOn != isProjectionLookupOn)
+		contentsStamp = getNewContentsStamp(); // the lookups don't agree exactly
+	isProjectionLookupOn = isOn;
+}
+
+void CubeMap::invalidate(void)
+{
+	contentsStamp = getNewContentsStamp();
+}
+
+void CubeMap::getFaceCoords(const V3 &direction, unsigned int &face, float &x, float &y) const
+{
+	float absX = fabsf(direction[0]), absY = fabsf(direction[1]), absZ = fabsf(direction[2]);
+	if (absX >= absY && absX >= absZ)
+		face = (direction[0] > 0.0f) ? 0 : 1;
+	else if (absY >= absZ)
+		face = (direction[1] > 0.0f) ? 4 : 5;
+	else
+		face = (direction[2] > 0.0f) ? 2 : 3;
+
+	// [-1,1] across the face, one divide. The face axes are unit
+	// coordinate axes so these dot products are really just picks
+	float oneOverMajor = 1.0f / (direction * faceViewDirs[face]);
+	float sc = (direction * faceAs[face]) * oneOverMajor;
+	float tc = (direction * faceBs[face]) * oneOverMajor;
+	// same as projecting through the 90 degree face camera
+	x = 0.5f * (sc + 1.0f) * (float)envMapResWidth;
+	y = 0.5f * (tc + 1.0f) * (float)envMapResHeight;
+}
+
+V3 CubeMap::getFaceTexel(unsigned int face, int i, int j) const
+{
+	int w = (int)envMapResWidth, h = (int)envMapResHeight;
+	if (i < 0 || i >= w || j < 0 || j >= h) {
+		// off the edge: go back to the direction through that texel's
+		// center and look up the face it really belongs to
+		float sc = 2.0f * ((float)i + 0.5f) / (float)w - 1.0f;
+		float tc = 2.0f * ((float)j + 0.5f) / (float)h - 1.0f;
+		V3 direction = faceViewDirs[face] + faceAs[face] * sc + faceBs[face] * tc;
+		float x, y;
+		getFaceCoords(direction, face, x, y);
+		i = (int)x;
+		j = (int)y;
+		i = (i < 0) ? 0 : ((i >= w) ? w - 1 : i);
+		j = (j < 0) ? 0 : ((j >= h) ? h - 1 : j);
+	}
+	const unsigned char *texel = cubeMapFaces[face]->getTexelsPtr()->data() + ((size_t)j * w + i) * 4;
+	unsigned int color;
+	memcpy(&color, texel, sizeof(color));
+	return V3(color);
+}
+
 V3 CubeMap::getColor(const V3 & direction)
+{
+	if (isProjectionLookupOn)
+		return getColorByProjection(direction);
+
+	unsigned int face;
+	float x, y;
+	getFaceCoords(direction, face, x, y);
+	// bilinear between the four texel centers around x, y
+	x -= 0.5f;
+	y -= 0.5f;
+	int i0 = (int)floorf(x), j0 = (int)floorf(y);
+	float dx = x - (float)i0, dy = y - (float)j0;
+	int w = (int)envMapResWidth, h = (int)envMapResHeight;
+	if (i0 >= 0 && j0 >= 0 && i0 + 1 < w && j0 + 1 < h) {
+		// all four on this face, which is nearly every lookup
+		const unsigned char *texels = cubeMapFaces[face]->getTexelsPtr()->data();
+		const unsigned char *c00 = texels + ((size_t)j0 * w + i0) * 4;
+		const unsigned char *c01 = c00 + (size_t)w * 4;
+		V3 top, bottom;
+		for (int k = 0; k < 3; k++) {
+			top[k] = (float)c00[k] + ((float)c00[k + 4] - (float)c00[k]) * dx;
+			bottom[k] = (float)c01[k] + ((float)c01[k + 4] - (float)c01[k]) * dx;
+		}
+		return (top + (bottom - top) * dy) / 255.0f;
+	}
+
+	V3 top = getFaceTexel(face, i0, j0) * (1.0f - dx) + getFaceTexel(face, i0 + 1, j0) * dx;
+	V3 bottom = getFaceTexel(face, i0, j0 + 1) * (1.0f - dx) + getFaceTexel(face, i0 + 1, j0 + 1) * dx;
+	return top * (1.0f - dy) + bottom * dy;
+}
+
+V3 CubeMap::getColorByProjection(const V3 & direction)
 {
 	// use direction to create a 3D point at the focal plane.
-	V3 lookAt3DPoint = cubeMapCenter + (direction * cubeMapFocalLength);
+	V3 lookAt3DPoint = cubeMapCenter + (direction.getNormalized() * cubeMapFocalLength);
 	V3 projectedPoint;
 	unsigned int returnColor;
 	bool isProjValid = false;
 	int timesTried = 0;
+	unsigned int face = currentLookAtFace;
 	// find the face that sees this point but start by the one used last time
 	// to leverage locality principle.
 	while(timesTried < 6) {
 
-		isProjValid = cubeMapFacesCams[currentLookAtFace % 6]->project(lookAt3DPoint, projectedPoint);
+		isProjValid = cubeMapFacesCams[face % 6]->project(lookAt3DPoint, projectedPoint);
 		// be very strict with the projection: no projection if:
 		// - point is left of view frustrum or is right of view frustrum
 		// - or is above view frustrum or is below of view frustrum
@@ -122,11 +206,12 @@ V3 CubeMap::getColor(const V3 & direction)
 			// bilinear interpolation assumes t ranges [0,1] starting from the bottom of texture
 			// and since y screen goes from top to bottom we need to flip t here as well
 			t = (envMapResHeight - 1.0f) - t;
-			returnColor = cubeMapFaces[currentLookAtFace % 6]->sampleTexBilinearTile(s, t);
+			returnColor = cubeMapFaces[face % 6]->sampleTexBilinearTile(s, t);
+			currentLookAtFace = face % 6;
 			return V3(returnColor);
 		}
 		else {
-			currentLookAtFace++; // try with a different face of the cube
+			face++; // try with a different face of the cube
 			timesTried++;
 		}
 	} 
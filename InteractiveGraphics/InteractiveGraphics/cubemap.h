@@ -1,6 +1,7 @@
 #pragma once
 #include "texture.h"
 #include "ppc.h"
+#include <atomic>
 
 class CubeMap
 {
@@ -12,13 +13,41 @@ class CubeMap
 	float envMapResHfov;
 	V3 cubeMapCenter; // (0.0f,0.0f,0.0f) by default
 	float cubeMapFocalLength;
-	unsigned int currentLookAtFace;
+	// last face that answered a lookup. Only a hint, but it is shared by
+	// the tiled rasterizer worker threads so it has to be atomic
+	std::atomic<unsigned int> currentLookAtFace;
+	// per face view direction and the directions texel columns (a) and
+	// rows (b) grow in, same as the face cameras' vd, a and b
+	V3 faceViewDirs[6], faceAs[6], faceBs[6];
+	// reference mode: find the face by projecting through the face cameras
+	bool isProjectionLookupOn = false;
+	// unique across all cube maps, renewed whenever lookups could start
+	// returning different colors. Lets users cache lookup results
+	unsigned int contentsStamp;
+
+	// picks the face by the direction's largest component and computes
+	// where on it the direction lands, in texels from the face's top left
+	void getFaceCoords(const V3 &direction, unsigned int &face, float &x, float &y) const;
+	// texel of face, (i, j) can be one texel outside of it: then the texel
+	// of the neighbouring face that direction falls on is used
+	V3 getFaceTexel(unsigned int face, int i, int j) const;
+	V3 getColorByProjection(const V3 &direction);
 
 public:
 	CubeMap(const string & texFilename);
 	~CubeMap();
 
 	Texture *getCubeFace(unsigned int i) const;
+	// bilinear environment lookup. Filters across face edges, so there
+	// is no seam where two faces meet. direction doesn't have to be normalized
 	V3 getColor(const V3 &direction);
+	// the old lookup that projects direction through up to six face
+	// cameras, kept to check the major axis lookup against
+	void setIsProjectionLookupOn(bool isOn);
+	bool getIsProjectionLookupOn(void) const { return isProjectionLookupOn; }
+	// changes with anything that changes what getColor returns. Texels
+	// changed through getCubeFace need a call to invalidate() to count
+	unsigned int getContentsStamp(void) const { return contentsStamp; }
+	void invalidate(void);
 };
 
@@ -0,0 +1,12 @@
+#pragma once
+
+// how triangle meshes get drawn. Kept out of scene.h so it can be used
+// without pulling in the GUI (e.g. by the headless renderer)
+enum class DrawModes { 
+	DOTS, 
+	WIREFRAME, 
+	FLAT, 
+	SCREENSCAPELERP, 
+	MODELSPACELERP, 
+	TEXTURE,
+	LIT};
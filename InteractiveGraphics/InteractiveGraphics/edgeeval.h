@@ -0,0 +1,208 @@
+#pragma once
+#include "v3.h"
+
+// SSE2 is baseline for x64 and the default /arch for x86 since VS2012
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define EDGEEVAL_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define EDGEEVAL_USE_SSE 0
+#endif
+
+// Evaluates the three edge expressions and the screen space 1/w plane of a
+// triangle for 4 horizontally consecutive pixels (a quad) at once. The
+// rasterizers walk their clipped AABB one quad at a time and only run
+// per pixel shading for the pixels whose bit is set in the returned mask.
+// Quads start at multiples of K_QUAD_W so they never reach into the next
+// block (or tile), even where the AABB starts or ends mid quad; lanes
+// outside of the AABB are masked off instead.
+// Edge expressions are evaluated directly at every quad (not accumulated)
+// so long rows don't drift. Quads are grouped in K_BLOCK_SIZE square blocks
+// which get classified as a whole first (coarse rasterization).
+class EdgeEvaluator {
+private:
+	float ea[3], eb[3], ec[3]; // edge expressions ea*u + eb*v + ec
+	float da, db, dc; // 1/w plane da*u + db*v + dc
+	float rowE[3], rowD; // v dependent part of the above for the current row
+public:
+	static const int K_QUAD_W = 4;
+	// rasterizers first walk their AABB in blocks of this many pixels
+	// squared so that blocks away from the triangle are skipped with one
+	// test and blocks well inside skip the per pixel edge tests
+	static const int K_BLOCK_SIZE = 8;
+	enum BlockCoverage { BLOCK_OUTSIDE, BLOCK_PARTIAL, BLOCK_COVERED };
+
+	EdgeEvaluator(const V3 *const eeqs, const V3 &depthABC)
+	{
+		for (int ei = 0; ei < 3; ei++) {
+			ea[ei] = eeqs[ei].getX();
+			eb[ei] = eeqs[ei].getY();
+			ec[ei] = eeqs[ei].getZ();
+		}
+		da = depthABC.getX();
+		db = depthABC.getY();
+		dc = depthABC.getZ();
+		setRow(0);
+	}
+
+	// must be called before evaluating quads of a new pixel row
+	inline void setRow(int v)
+	{
+		float vc = (float)v + 0.5f; // pixel center
+		for (int ei = 0; ei < 3; ei++)
+			rowE[ei] = eb[ei] * vc + ec[ei];
+		rowD = db * vc + dc;
+	}
+
+	// classifies the block of pixels [u0, u1] x [v0, v1] against the triangle
+	// by looking at the edge expressions at the block corner pixel centers.
+	// Edge expressions are linear so the smallest and largest value over the
+	// block are always found at the corners.
+	inline BlockCoverage classifyBlock(int u0, int v0, int u1, int v1) const
+	{
+		float uc0 = (float)u0 + 0.5f, uc1 = (float)u1 + 0.5f;
+		float vc0 = (float)v0 + 0.5f, vc1 = (float)v1 + 0.5f;
+		bool isCovered = true;
+		for (int ei = 0; ei < 3; ei++) {
+			// pick the corner that maximizes / minimizes the expression
+			float maxE = ea[ei] * ((ea[ei] > 0.0f) ? uc1 : uc0) +
+				eb[ei] * ((eb[ei] > 0.0f) ? vc1 : vc0) + ec[ei];
+			if (maxE < 0.0f)
+				return BLOCK_OUTSIDE; // whole block on the wrong side of this edge
+			float minE = ea[ei] * ((ea[ei] > 0.0f) ? uc0 : uc1) +
+				eb[ei] * ((eb[ei] > 0.0f) ? vc0 : vc1) + ec[ei];
+			if (minE < 0.0f)
+				isCovered = false;
+		}
+		return isCovered ? BLOCK_COVERED : BLOCK_PARTIAL;
+	}
+
+	// largest (i.e. closest) 1/w of the triangle plane over the pixel
+	// centers of block [u0, u1] x [v0, v1]. Again found at a corner.
+	// Evaluated in the same order as computeQuadMask so it is never below
+	// the 1/w any pixel of the block gets
+	inline float getMaxDepth(int u0, int v0, int u1, int v1) const
+	{
+		float uc = (float)((da > 0.0f) ? u1 : u0) + 0.5f;
+		float vc = (float)((db > 0.0f) ? v1 : v0) + 0.5f;
+		return da * uc + (db * vc + dc);
+	}
+
+	// returns bit mask of pixels u..u+3 (bit i is pixel u+i) that are inside
+	// the triangle and within [left, right]. If zbRow is provided those pixels also
+	// have to be closer (larger 1/w) than what zbRow holds. rowLen is the
+	// number of valid entries in zbRow. 1/w for the 4 pixels goes in depthOut.
+	// isCovered skips the edge tests for quads of a BLOCK_COVERED block.
+	inline int computeQuadMask(int u, int left, int right,
+		const float *zbRow, int rowLen, float *depthOut, bool isCovered = false) const
+	{
+		float uc = (float)u + 0.5f; // pixel center
+#if EDGEEVAL_USE_SSE
+		__m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		__m128 laneU = _mm_add_ps(_mm_set1_ps(uc), laneOffsets);
+		__m128 zero = _mm_setzero_ps();
+		// lanes before the left end or past the right end of the span don't exist
+		__m128 mask = _mm_and_ps(
+			_mm_cmpge_ps(laneOffsets, _mm_set1_ps((float)(left - u))),
+			_mm_cmplt_ps(laneOffsets, _mm_set1_ps((float)(right - u + 1))));
+		for (int ei = 0; ei < 3 && !isCovered; ei++) {
+			__m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[ei]), laneU), _mm_set1_ps(rowE[ei]));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(e, zero));
+		}
+		__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(da), laneU), _mm_set1_ps(rowD));
+		_mm_storeu_ps(depthOut, depth);
+		if (zbRow != nullptr) {
+			__m128 zbv;
+			if (u + K_QUAD_W <= rowLen)
+				zbv = _mm_loadu_ps(zbRow + u);
+			else // don't read past the end of the buffer
+				zbv = _mm_set_ps(
+					(u + 3 < rowLen) ? zbRow[u + 3] : 0.0f,
+					(u + 2 < rowLen) ? zbRow[u + 2] : 0.0f,
+					(u + 1 < rowLen) ? zbRow[u + 1] : 0.0f,
+					zbRow[u]);
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(depth, zbv));
+		}
+		return _mm_movemask_ps(mask);
+#else
+		int mask = 0;
+		for (int qi = 0; qi < K_QUAD_W && u + qi <= right; qi++) {
+			float uq = uc + (float)qi;
+			depthOut[qi] = da * uq + rowD;
+			if (u + qi < left)
+				continue;
+			if (!isCovered && (
+				ea[0] * uq + rowE[0] < 0.0f ||
+				ea[1] * uq + rowE[1] < 0.0f ||
+				ea[2] * uq + rowE[2] < 0.0f))
+				continue;
+			if (zbRow != nullptr && zbRow[u + qi] >= depthOut[qi])
+				continue;
+			mask |= (1 << qi);
+		}
+		return mask;
+#endif
+	}
+
+	// evaluates an arbitrary screen space linear expression (e.g. the
+	// perspective correct denominator) for pixels u..u+3 of row v
+	static inline void evalPlaneQuad(const V3 &plane, int u, int v, float *out)
+	{
+		float uc = (float)u + 0.5f;
+		float rowVal = plane.getY() * ((float)v + 0.5f) + plane.getZ();
+#if EDGEEVAL_USE_SSE
+		__m128 laneU = _mm_add_ps(_mm_set1_ps(uc), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+		_mm_storeu_ps(out, _mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(plane.getX()), laneU), _mm_set1_ps(rowVal)));
+#else
+		for (int qi = 0; qi < K_QUAD_W; qi++)
+			out[qi] = plane.getX() * (uc + (float)qi) + rowVal;
+#endif
+	}
+
+	// masked writes of a quad into a row of rowLen 32 bit values: lane i
+	// of values goes to row[u + i] only if bit i of mask is set
+	static inline void maskedStoreQuad(float *row, int rowLen, int u, int mask, const float *values)
+	{
+#if EDGEEVAL_USE_SSE
+		if (u + K_QUAD_W <= rowLen) {
+			__m128 laneMask = _mm_castsi128_ps(getLaneMask(mask));
+			__m128 oldv = _mm_loadu_ps(row + u);
+			__m128 newv = _mm_loadu_ps(values);
+			_mm_storeu_ps(row + u, _mm_or_ps(_mm_and_ps(laneMask, newv), _mm_andnot_ps(laneMask, oldv)));
+			return;
+		}
+#endif
+		for (int qi = 0; qi < K_QUAD_W; qi++) {
+			if (mask & (1 << qi))
+				row[u + qi] = values[qi];
+		}
+	}
+	static inline void maskedStoreQuad(unsigned int *row, int rowLen, int u, int mask, unsigned int value)
+	{
+#if EDGEEVAL_USE_SSE
+		if (u + K_QUAD_W <= rowLen) {
+			__m128i laneMask = getLaneMask(mask);
+			__m128i oldv = _mm_loadu_si128((const __m128i *)(row + u));
+			__m128i newv = _mm_set1_epi32((int)value);
+			_mm_storeu_si128((__m128i *)(row + u),
+				_mm_or_si128(_mm_and_si128(laneMask, newv), _mm_andnot_si128(laneMask, oldv)));
+			return;
+		}
+#endif
+		for (int qi = 0; qi < K_QUAD_W; qi++) {
+			if (mask & (1 << qi))
+				row[u + qi] = value;
+		}
+	}
+
+private:
+#if EDGEEVAL_USE_SSE
+	// expands 4 bit mask into all ones / all zeros 32 bit lanes
+	static inline __m128i getLaneMask(int mask)
+	{
+		__m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+		return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(mask), laneBits), laneBits);
+	}
+#endif
+};
@@ -47,8 +47,8 @@ void HWFrameBuffer::loadTextures(void)
 			width, height);  
 
 		// Define some data to upload into the texture
-		vector<unsigned char> &dataVector = it->first->getTexelsRef();
-		unsigned char * data = &dataVector[0];
+		const vector<unsigned char> &dataVector = it->first->getTexelsRef();
+		const unsigned char * data = &dataVector[0];
 
 		// Assume the texture is already bound to the GL_TEXTURE_2D target
 		glTexSubImage2D(GL_TEXTURE_2D,  // 2D texture
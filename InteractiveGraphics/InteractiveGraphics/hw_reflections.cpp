@@ -87,8 +87,8 @@ void HWReflections::loadTextures(void)
 
 	glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGBA8, envTexWidth, envTexHeight);
 	
-	vector<unsigned char> *dataVector = texPointer->getTexelsPtr();
-	unsigned char * data = dataVector->data();
+	const vector<unsigned char> *dataVector = texPointer->getTexelsPtr();
+	const unsigned char * data = dataVector->data();
 
 	// upload environment cube face data 
 	glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 
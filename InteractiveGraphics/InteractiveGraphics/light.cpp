@@ -1,10 +1,40 @@
+#define _USE_MATH_DEFINES // need this for visual studio to find M_PI
 #include "light.h"
-#include "framebuffer.h"
 #include "tmesh.h"
 #include "ppc.h"
+#include "aabb.h"
+#include "workerpool.h"
+#include "sw_rendertarget.h"
+#include "sw_depthtarget.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+using std::cerr;
+using std::endl;
+using std::max;
+using std::min;
+
+// cascade splits: 0 gives uniform slices, 1 logarithmic ones (near
+// slices thinner, same texel to pixel ratio in all of them)
+static const float K_CASCADE_SPLIT_LAMBDA = 0.75f;
+// default depth test tolerance of the cascades, in shadow map texels along
+// the light. There is no slope scaled term, so this constant bias alone
+// has to cover receivers seen at grazing angles by the light
+static const float K_DEFAULT_CASCADE_BIAS_TEXELS = 8.0f;
+#ifndef SW_HEADLESS
+#include "sw_framebuffer.h"
 #include "scene.h"
 
 Light::Light(bool isPointLight, float hfov) :
+	// because the pixel will be unprojected to 3D using the rendering camera,
+	// these shadow map cameras have to match its view frustrum.
+	Light(isPointLight, (hfov == 0.0f) ? Scene::K_HFOV : hfov, Scene::K_W, Scene::K_H)
+{
+}
+#endif
+
+Light::Light(bool isPointLight, float hfov,
+	unsigned int resWidth, unsigned int resHeight) :
 	isPointLgiht(isPointLight),
 	position(V3()),
 	direction(V3(0.0f, 0.0f, -1.0f)), // this can't be zero by default or it will affect positioning
@@ -12,17 +42,28 @@ Light::Light(bool isPointLight, float hfov) :
 	matColor(V3()),
 	ambientK(0.0f),
 	shadowMapCube(nullptr),
+	shadowColorMaps(nullptr),
+#ifndef SW_HEADLESS
+	shadowMapWindows(nullptr),
+#endif
 	shadowMapCams(nullptr),
 	shadowMapsN(0),
-	// because the pixel will be unprojected to 3D using the rendering camera,
-	// these shadow map cameras have to match its view frustrum.
-	shadowMapResWidth(Scene::K_W),
-	shadowMapResHeight(Scene::K_H),
-	shadowMapResHfov(hfov)
+	shadowMapResWidth(resWidth),
+	shadowMapResHeight(resHeight),
+	shadowMapResHfov(hfov),
+	pcfKernelSize(1),
+	shadowEpsilon(0.15f),
+	cascadesN(0),
+	cascadesNear(0.0f),
+	cascadesFar(0.0f),
+	cascadeBiasTexels(K_DEFAULT_CASCADE_BIAS_TEXELS)
 
 {
-	if (hfov == 0.0f) // default, no hfov was provided
-		shadowMapResHfov = Scene::K_HFOV;
+	for (unsigned int i = 0; i < K_MAX_CASCADES; i++) {
+		cascadeMaps[i] = nullptr;
+		cascadeCams[i] = nullptr;
+	}
+	cascadesBuiltState.isValid = false;
 
 	if (isPointLight) {
 		// a point light supports a shadow cubemap however 
@@ -43,12 +84,25 @@ Light::Light(bool isPointLight, float hfov) :
 		isUsingCubemap = false;
 	}
 
-	shadowMapCube = new SWFrameBuffer*[shadowMapsN];
+	allocateShadowMaps();
+}
+
+
+Light::~Light()
+{
+	freeShadowMaps();
+	freeCascades();
+}
+
+void Light::allocateShadowMaps(void)
+{
+	shadowMapCube = new SWDepthTarget*[shadowMapsN];
 	shadowMapCams = new PPC*[shadowMapsN];
 
 	for (unsigned int i = 0; i < shadowMapsN; i++) {
-		// set up shadow maps
-		shadowMapCube[i] = new SWFrameBuffer(0, 0,
+		// set up shadow maps (depth only, no window needed, see
+		// buildShadowMaps for visual debug)
+		shadowMapCube[i] = new SWDepthTarget(
 			shadowMapResWidth, shadowMapResHeight);
 		// set up shadow maps aux cameras
 		shadowMapCams[i] = new PPC(
@@ -58,10 +112,10 @@ Light::Light(bool isPointLight, float hfov) :
 	}
 	// position and orient shadow maps aux cameras
 	setUpShadowMapCams();
+	builtState.isValid = false;
 }
 
-
-Light::~Light()
+void Light::freeShadowMaps(void)
 {
 	for (unsigned int i = 0; i < shadowMapsN; i++) {
 		delete shadowMapCube[i];
@@ -69,6 +123,96 @@ Light::~Light()
 	}
 	delete[] shadowMapCams;
 	delete[] shadowMapCube;
+	shadowMapCams = nullptr;
+	shadowMapCube = nullptr;
+	if (shadowColorMaps) {
+		for (unsigned int i = 0; i < shadowMapsN; i++)
+			delete shadowColorMaps[i];
+		delete[] shadowColorMaps;
+		shadowColorMaps = nullptr;
+	}
+#ifndef SW_HEADLESS
+	if (shadowMapWindows) {
+		for (unsigned int i = 0; i < shadowMapsN; i++)
+			delete shadowMapWindows[i];
+		delete[] shadowMapWindows;
+		shadowMapWindows = nullptr;
+	}
+#endif
+}
+
+void Light::setShadowMapResolution(unsigned int resWidth, unsigned int resHeight)
+{
+	if (resWidth == shadowMapResWidth && resHeight == shadowMapResHeight)
+		return;
+	freeShadowMaps();
+	freeCascades();
+	shadowMapResWidth = resWidth;
+	shadowMapResHeight = resHeight;
+	allocateShadowMaps();
+	allocateCascades();
+}
+
+void Light::allocateCascades(void)
+{
+	for (unsigned int i = 0; i < cascadesN; i++) {
+		cascadeMaps[i] = new SWDepthTarget(shadowMapResWidth, shadowMapResHeight);
+		// intrinsics get fitted to the view frustum slice on every build
+		cascadeCams[i] = new PPC(shadowMapResHfov, shadowMapResWidth, shadowMapResHeight);
+	}
+	cascadesBuiltState.isValid = false;
+}
+
+void Light::freeCascades(void)
+{
+	for (unsigned int i = 0; i < K_MAX_CASCADES; i++) {
+		delete cascadeMaps[i];
+		delete cascadeCams[i];
+		cascadeMaps[i] = nullptr;
+		cascadeCams[i] = nullptr;
+	}
+}
+
+void Light::setCascades(unsigned int newCascadesN, float nearDistance, float farDistance)
+{
+	if (isPointLgiht && newCascadesN > 0) {
+		cerr << "ERROR: cascaded shadow maps are only supported for directional lights" << endl;
+		return;
+	}
+	if (newCascadesN > 0 && (nearDistance <= 0.0f || farDistance <= nearDistance)) {
+		cerr << "ERROR: cascades need 0 < near distance < far distance" << endl;
+		return;
+	}
+	freeCascades();
+	cascadesN = min(newCascadesN, K_MAX_CASCADES);
+	cascadesNear = nearDistance;
+	cascadesFar = farDistance;
+	if (cascadesN == 0)
+		return;
+
+	// practical split scheme, a blend of logarithmic and uniform splits.
+	// Logarithmic alone makes the near slices too thin to be useful
+	for (unsigned int i = 0; i <= cascadesN; i++) {
+		float fraction = (float)i / (float)cascadesN;
+		float logSplit = nearDistance * powf(farDistance / nearDistance, fraction);
+		float uniformSplit = nearDistance + (farDistance - nearDistance) * fraction;
+		cascadeSplits[i] = K_CASCADE_SPLIT_LAMBDA * logSplit + (1.0f - K_CASCADE_SPLIT_LAMBDA) * uniformSplit;
+	}
+	allocateCascades();
+}
+
+size_t Light::getShadowMapsSizeInBytes(void) const
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < shadowMapsN; i++) {
+		bytes += shadowMapCube[i]->getSizeInBytes();
+		// color and z buffer
+		if (shadowColorMaps)
+			bytes += (sizeof(unsigned int) + sizeof(float)) * shadowMapResWidth * shadowMapResHeight;
+	}
+	for (unsigned int i = 0; i < cascadesN; i++)
+		bytes += cascadeMaps[i]->getSizeInBytes();
+	return bytes;
 }
 
 V3 Light::computeDiffuseContribution(const V3 & triangleVertex, const V3 & normal) const
@@ -94,11 +238,20 @@ V3 Light::computeDiffuseContribution(const V3 & triangleVertex, const V3 & norma
 bool Light::isPointInShadow(const V3 & point) const
 {
 	// assumes the shadow map or shadow maps are to date at this point
-	static float const epsilon = 0.15f;
+	float epsilon = shadowEpsilon;
 	V3 projP;
 	bool isProjValid;
+	// cascades replace the single shadow map of a directional light
+	if (cascadesN > 0) {
+		int i = getCascadeIndex((point - cascadesBuiltState.viewEye) * cascadesViewDir);
+		if (i >= 0 && cascadeCams[i]->project(point, projP) &&
+			(projP[0] > 0.0f) && (projP[0] < cascadeCams[i]->getWidth()) &&
+			(projP[1] > 0.0f) && (projP[1] < cascadeCams[i]->getHeight()))
+			return !(cascadeMaps[i]->isDepthTestPass(projP, cascadeEpsilons[i]));
+		return false;
+	}
 	// determine if using shadow map cube
-	if (isPointLgiht && isUsingCubemap) {
+	else if (isPointLgiht && isUsingCubemap) {
 		// iterate through shadow maps until we find an answer
 		for (unsigned int i = 0; i < shadowMapsN; i++) {
 			// project 3d point into ith shadow map for query
@@ -134,88 +287,339 @@ bool Light::isPointInShadow(const V3 & point) const
 	return false;
 }
 
+float Light::getShadowFactor(const V3 & point) const
+{
+	// same face selection and frustum checks as isPointInShadow
+	V3 projP;
+	if (cascadesN > 0) {
+		int i = getCascadeIndex((point - cascadesBuiltState.viewEye) * cascadesViewDir);
+		if (i < 0)
+			return 0.0f;
+		const PPC &cascadeCam = *cascadeCams[i];
+		return getShadowFactorFromMap(*cascadeMaps[i],
+			cascadeCam.getProjM() * (point - cascadeCam.getEyePoint()), 1.0f, cascadeEpsilons[i]);
+	}
+	unsigned int facesN = (isPointLgiht && isUsingCubemap) ? shadowMapsN : 1;
+	for (unsigned int i = 0; i < facesN; i++) {
+		if (shadowMapCams[i]->project(point, projP) &&
+			(projP[0] > 0.0f) && (projP[0] < shadowMapCams[i]->getWidth()) &&
+			(projP[1] > 0.0f) && (projP[1] < shadowMapCams[i]->getHeight()))
+			return shadowMapCube[i]->getPCFShadowFactor(projP, shadowEpsilon, pcfKernelSize);
+	}
+	return 0.0f;
+}
+
+void Light::getShadowFactorSpan(const PPC & cam, float u0, float v,
+	const float * oneOverWs, int n, float * shadowFactors) const
+{
+	if (isPointLgiht && isUsingCubemap) {
+		// the face can change along the span, no shortcut
+		for (int i = 0; i < n; i++)
+			shadowFactors[i] = getShadowFactor(cam.unproject(V3(u0 + (float)i, v, oneOverWs[i])));
+		return;
+	}
+
+	// the pixel's 3D point is P = C + (a*u + b*v + c) / (1/w), which the
+	// shadow camera projects with q = M * (P - Cs). Scaled by 1/w that is
+	// (1/w) * M * (C - Cs) + M * (a*u + b*v + c): the second term is linear
+	// in u, and scaling q doesn't change the projection
+	V3 ray0 = cam.getLowerCaseA() * u0 + cam.getLowerCaseB() * v + cam.getLowerCaseC();
+	if (cascadesN > 0) {
+		// the view depth that picks the cascade is (P - E) * vd for the eye
+		// E and view direction vd the cascades were fitted to, which is
+		// linear in u the same way after the division by 1/w
+		float eyeDepth = (cam.getEyePoint() - cascadesBuiltState.viewEye) * cascadesViewDir;
+		float rayDepth = ray0 * cascadesViewDir;
+		float rayDepthStep = cam.getLowerCaseA() * cascadesViewDir;
+		V3 eyeTerms[K_MAX_CASCADES], rayTerms[K_MAX_CASCADES], raySteps[K_MAX_CASCADES];
+		for (unsigned int k = 0; k < cascadesN; k++) {
+			const M33 &projM = cascadeCams[k]->getProjM();
+			eyeTerms[k] = projM * (cam.getEyePoint() - cascadeCams[k]->getEyePoint());
+			rayTerms[k] = projM * ray0;
+			raySteps[k] = projM * cam.getLowerCaseA();
+		}
+		for (int i = 0; i < n; i++) {
+			float oneOverW = oneOverWs[i];
+			int k = getCascadeIndex(eyeDepth + (rayDepth + rayDepthStep * (float)i) / oneOverW);
+			shadowFactors[i] = (k < 0) ? 0.0f : getShadowFactorFromMap(*cascadeMaps[k],
+				eyeTerms[k] * oneOverW + rayTerms[k] + raySteps[k] * (float)i, oneOverW, cascadeEpsilons[k]);
+		}
+		return;
+	}
+
+	const PPC &shadowCam = *shadowMapCams[0];
+	const M33 &projM = shadowCam.getProjM();
+	V3 eyeTerm = projM * (cam.getEyePoint() - shadowCam.getEyePoint());
+	V3 rayTerm = projM * ray0;
+	V3 rayStep = projM * cam.getLowerCaseA();
+	for (int i = 0; i < n; i++, rayTerm += rayStep) {
+		shadowFactors[i] = getShadowFactorFromMap(*shadowMapCube[0],
+			eyeTerm * oneOverWs[i] + rayTerm, oneOverWs[i], shadowEpsilon);
+	}
+}
+
+float Light::getShadowFactorFromMap(const SWDepthTarget & map, const V3 & q,
+	float oneOverW, float epsilon) const
+{
+	if (q[2] <= 0.0f)
+		return 0.0f; // behind the shadow camera
+	float oneOverQz = 1.0f / q[2];
+	V3 projP(q[0] * oneOverQz, q[1] * oneOverQz, oneOverW * oneOverQz);
+	// as strict as isPointInShadow
+	if ((projP[0] > 0.0f) && (projP[0] < (float)map.getWidth()) &&
+		(projP[1] > 0.0f) && (projP[1] < (float)map.getHeight()))
+		return map.getPCFShadowFactor(projP, epsilon, pcfKernelSize);
+	return 0.0f;
+}
+
+int Light::getCascadeIndex(float viewDepth) const
+{
+	// also false for NaN depths
+	if (!(viewDepth <= cascadeSplits[cascadesN]))
+		return -1;
+	for (unsigned int i = 0; i + 1 < cascadesN; i++) {
+		if (viewDepth < cascadeSplits[i + 1])
+			return (int)i;
+	}
+	return (int)cascadesN - 1;
+}
+
 void Light::buildShadowMaps(
 	vector<TMesh *> &tMeshArray,
 	bool isDbgShowShadowMaps,
 	bool isDrawModeFlat)
 {
-	V3 filColors[3] = { // for visual debug (isDbgShowShadowMaps)
-		V3(1.0f, 0.0f, 0.0f),
-		V3(0.0f, 1.0f, 0.0f),
-		V3(0.0f, 0.0f, 1.0f),
-	};
-	cleanShadowMaps();
-	setUpShadowMapCams();
+	bool isRebuildNeeded = !isShadowMapsStateCurrent(builtState, tMeshArray, isDrawModeFlat);
+	if (isRebuildNeeded) {
+		if (!isDrawModeFlat && shadowColorMaps == nullptr) {
+			// stealth mode reads colors back from the shadow map, only
+			// then it pays for color buffers
+			shadowColorMaps = new SWRenderTarget*[shadowMapsN];
+			for (unsigned int i = 0; i < shadowMapsN; i++)
+				shadowColorMaps[i] = new SWRenderTarget(shadowMapResWidth, shadowMapResHeight);
+		}
+		cleanShadowMaps();
+		setUpShadowMapCams();
+	}
 
+	if (!isRebuildNeeded) {
+		// nothing moved, the maps are still good
+	}
+	// depth only, the usual case
+	else if (isDrawModeFlat) {
+		drawDepthMaps(shadowMapCube, shadowMapCams,
+			(isPointLgiht && isUsingCubemap) ? shadowMapsN : 1, tMeshArray);
+	}
 	// determine if using shadow map cube
-	if (isPointLgiht && isUsingCubemap) {
-
+	else if (isPointLgiht && isUsingCubemap) {
 		// For all the shadow maps 
 		// (6 sides of shadow map cube for point lights with
 		// shadow map enabled)
 		for (unsigned int i = 0; i < shadowMapsN; i++) {
 			// Render all geometry into this shadow map
-			unsigned int j = 0;
-			for (vector<TMesh *>::iterator it = tMeshArray.begin();
-			it != tMeshArray.end();
-				++it, j++)
-			{
-				if (isDrawModeFlat == true) {
-					(*it)->drawFilledFlatWithDepth(
-						*shadowMapCube[i],
-						*shadowMapCams[i],
-						filColors[j % 3].getColor());
-				}
-				else { // this is only used by stealth mode 
-					(*it)->drawFilledFlatPerspCorrect(
-						*shadowMapCube[i],
-						*shadowMapCams[i]);
-				}
+			for (TMesh *tMesh : tMeshArray) {
+				tMesh->drawFilledFlatPerspCorrect(
+					*shadowColorMaps[i],
+					*shadowMapCams[i]);
 			}
-
+			shadowMapCube[i]->copyZB(*shadowColorMaps[i]);
 		}
 	}
 	// its either a directional light or a point light with cubemap disabled
 	else {
 		// Render all geometry into this shadow map
-		unsigned int j = 0;
-		for (vector<TMesh *>::iterator it = tMeshArray.begin();
-		it != tMeshArray.end();
-			++it, j++)
-		{
-			if (isDrawModeFlat == true) {
-				(*it)->drawFilledFlatWithDepth(
-					*shadowMapCube[0],
-					*shadowMapCams[0],
-					filColors[j % 3].getColor());
-			}
-			else { // this is only used by stealth mode
-				(*it)->drawFilledFlatBarycentric(
-					*shadowMapCube[0],
-					*shadowMapCams[0]);
-			}
+		for (TMesh *tMesh : tMeshArray) {
+			// this is only used by stealth mode
+			tMesh->drawFilledFlatBarycentric(
+				*shadowColorMaps[0],
+				*shadowMapCams[0]);
 		}
+		shadowMapCube[0]->copyZB(*shadowColorMaps[0]);
 	}
 
+	if (isRebuildNeeded)
+		recordShadowMapsState(builtState, tMeshArray, isDrawModeFlat);
+
+#ifndef SW_HEADLESS
 	// For debug, visualize these shadowMaps as framebuffers
 	if (isDbgShowShadowMaps && isUsingCubemap) {
-		for (unsigned int i = 0; i < shadowMapsN; i++) {
-			if (!shadowMapCube[i]->shown())
-				shadowMapCube[i]->show();
-			else
-				shadowMapCube[i]->redraw();
-		}
+		for (unsigned int i = 0; i < shadowMapsN; i++)
+			showShadowMap(i);
 	}
 	// its either a directional light or a point light with cubemap disabled
 	else if(isDbgShowShadowMaps) {
-		if (!shadowMapCube[0]->shown())
-			shadowMapCube[0]->show();
-		else
-			shadowMapCube[0]->redraw();
+		showShadowMap(0);
+	}
+#else
+	(void)isDbgShowShadowMaps; // no windows to show them in
+#endif
+}
+
+void Light::buildCascadedShadowMaps(vector<TMesh *> &tMeshArray, const PPC & viewCam)
+{
+	if (cascadesN == 0) {
+		buildShadowMaps(tMeshArray);
+		return;
+	}
+	if (isShadowMapsStateCurrent(cascadesBuiltState, tMeshArray, true, &viewCam))
+		return; // neither the light, the meshes nor the view moved
+
+	setUpCascadeCams(viewCam, tMeshArray);
+	for (unsigned int i = 0; i < cascadesN; i++)
+		cascadeMaps[i]->clearZB(0.0f);
+	drawDepthMaps(cascadeMaps, cascadeCams, cascadesN, tMeshArray);
+	recordShadowMapsState(cascadesBuiltState, tMeshArray, true, &viewCam);
+}
+
+void Light::drawDepthMaps(SWDepthTarget *const *maps, PPC *const *cams,
+	unsigned int mapsN, const vector<TMesh *> &tMeshArray)
+{
+	// the maps don't share anything but the (read only) meshes, so one map
+	// per worker. With fewer maps than workers the maps are also split into
+	// bands of rows (a single shadow map gets one band per worker)
+	int threadsN = (int)WorkerPool::getShared().getThreadsN();
+	int bandsN = (threadsN + (int)mapsN - 1) / (int)mapsN;
+	WorkerPool::getShared().parallelFor((int)mapsN * bandsN, [&](int job) {
+		int i = job / bandsN;
+		int band = job % bandsN;
+		int bandHeight = (maps[i]->getHeight() + bandsN - 1) / bandsN;
+		for (TMesh *tMesh : tMeshArray) {
+			tMesh->drawDepthOnly(*maps[i], *cams[i],
+				band * bandHeight, (band + 1) * bandHeight);
+		}
+	});
+}
+
+void Light::setUpCascadeCams(const PPC & viewCam, const vector<TMesh *> &tMeshArray)
+{
+	V3 viewEye = viewCam.getEyePoint();
+	cascadesViewDir = viewCam.getViewDir();
+	// rays through the corners of the view image, scaled to view depth 1
+	V3 cornerRays[4];
+	for (int j = 0; j < 4; j++) {
+		V3 ray = viewCam.getLowerCaseA() * (float)((j & 1) ? viewCam.getWidth() : 0) +
+			viewCam.getLowerCaseB() * (float)((j & 2) ? viewCam.getHeight() : 0) +
+			viewCam.getLowerCaseC();
+		cornerRays[j] = ray / (ray * cascadesViewDir);
+	}
+
+	// anything in the scene can cast a shadow into a slice, so the cascade
+	// cameras back off until every mesh is in front of them
+	vector<V3> casterCorners;
+	for (TMesh *tMesh : tMeshArray) {
+		AABB aabb = tMesh->getAABB();
+		V3 c0 = aabb.getFristCorner(), c1 = aabb.getSecondCorner();
+		for (int j = 0; j < 8; j++)
+			casterCorners.push_back(V3((j & 1) ? c1[0] : c0[0], (j & 2) ? c1[1] : c0[1], (j & 4) ? c1[2] : c0[2]));
+	}
+
+	V3 lightDir = direction.getNormalized();
+	V3 up = (fabsf(lightDir[1]) > 0.99f) ? V3(0.0f, 0.0f, 1.0f) : V3(0.0f, 1.0f, 0.0f);
+	V3 lightRight = (lightDir ^ up).getNormalized();
+	V3 lightUp = (lightDir ^ lightRight).getNormalized();
+	int minRes = (int)min(shadowMapResWidth, shadowMapResHeight);
+
+	for (unsigned int i = 0; i < cascadesN; i++) {
+		// bounding sphere of the slice; its size doesn't change as the view
+		// turns, so neither does the shadow map texel size
+		V3 sliceCorners[8];
+		V3 center(0.0f, 0.0f, 0.0f);
+		for (int j = 0; j < 8; j++) {
+			float depth = (j < 4) ? cascadeSplits[i] : cascadeSplits[i + 1];
+			sliceCorners[j] = viewEye + cornerRays[j % 4] * depth;
+			center = center + sliceCorners[j] * (1.0f / 8.0f);
+		}
+		float radius = 0.0f;
+		for (int j = 0; j < 8; j++)
+			radius = max(radius, (sliceCorners[j] - center).length());
+		// move the center in whole texels across the light so the shadow
+		// edges don't crawl while the view moves
+		float texelSize = 2.0f * radius / (float)minRes;
+		float x = center * lightRight, y = center * lightUp;
+		center = center + lightRight * (floorf(x / texelSize + 0.5f) * texelSize - x) +
+			lightUp * (floorf(y / texelSize + 0.5f) * texelSize - y);
+
+		float distance = 2.0f * radius;
+		for (const V3 &casterCorner : casterCorners)
+			distance = max(distance, (center - casterCorner) * lightDir + radius);
+		// field of view that just fits the sphere in the shorter image side
+		float halfTan = radius / sqrtf(distance * distance - radius * radius) *
+			(float)shadowMapResWidth / (float)minRes;
+		float hfovDeg = 2.0f * atanf(halfTan) * 180.0f / (float)M_PI;
+		*cascadeCams[i] = PPC(hfovDeg, shadowMapResWidth, shadowMapResHeight);
+		cascadeCams[i]->positionRelativeToPoint(center, lightDir, up, distance);
+		// a texel is distance / f wide around the center and 1/w = f / depth,
+		// so a depth offset of bias texels is bias / distance in 1/w
+		cascadeEpsilons[i] = cascadeBiasTexels / distance;
+	}
+}
+
+bool Light::isShadowMapsStateCurrent(const ShadowMapsState &state,
+	const vector<TMesh *> &tMeshArray, bool isDrawModeFlat, const PPC *viewCam) const
+{
+	if (!state.isValid || !(state.position == position) ||
+		!(state.direction == direction) || state.isUsingCubemap != isUsingCubemap ||
+		state.isDrawModeFlat != isDrawModeFlat ||
+		state.meshStamps.size() != tMeshArray.size())
+		return false;
+	if (viewCam && (!(state.viewEye == viewCam->getEyePoint()) ||
+		!(state.viewA == viewCam->getLowerCaseA()) || !(state.viewB == viewCam->getLowerCaseB()) ||
+		!(state.viewC == viewCam->getLowerCaseC())))
+		return false;
+	// same meshes in the same order (the order picks the debug colors),
+	// none of them moved
+	for (size_t j = 0; j < tMeshArray.size(); j++) {
+		if (state.meshStamps[j].first != tMeshArray[j] ||
+			state.meshStamps[j].second != tMeshArray[j]->getVertsStamp())
+			return false;
+	}
+	return true;
+}
+
+void Light::recordShadowMapsState(ShadowMapsState &state,
+	const vector<TMesh *> &tMeshArray, bool isDrawModeFlat, const PPC *viewCam) const
+{
+	state.isValid = true;
+	state.position = position;
+	state.direction = direction;
+	state.isUsingCubemap = isUsingCubemap;
+	state.isDrawModeFlat = isDrawModeFlat;
+	if (viewCam) {
+		state.viewEye = viewCam->getEyePoint();
+		state.viewA = viewCam->getLowerCaseA();
+		state.viewB = viewCam->getLowerCaseB();
+		state.viewC = viewCam->getLowerCaseC();
 	}
+	state.meshStamps.clear();
+	for (TMesh *tMesh : tMeshArray)
+		state.meshStamps.push_back(std::make_pair(tMesh, tMesh->getVertsStamp()));
 }
 
-void Light::draw(SWFrameBuffer & fb, const PPC & ppc, V3 & color) const
+#ifndef SW_HEADLESS
+void Light::showShadowMap(unsigned int i)
+{
+	if (shadowMapWindows == nullptr) {
+		shadowMapWindows = new SWFrameBuffer*[shadowMapsN];
+		for (unsigned int j = 0; j < shadowMapsN; j++)
+			shadowMapWindows[j] = nullptr;
+	}
+	if (shadowMapWindows[i] == nullptr)
+		shadowMapWindows[i] = new SWFrameBuffer(0, 0,
+			shadowMapResWidth, shadowMapResHeight);
+
+	// maps built with colors show those, depth only ones their depth
+	if (shadowColorMaps && !builtState.isDrawModeFlat)
+		shadowMapWindows[i]->copyPixels(*shadowColorMaps[i]);
+	else
+		shadowMapCube[i]->drawAsGrayLevels(*shadowMapWindows[i]);
+	if (!shadowMapWindows[i]->shown())
+		shadowMapWindows[i]->show();
+	else
+		shadowMapWindows[i]->redraw();
+}
+#endif
+
+void Light::draw(SWRenderTarget & fb, const PPC & ppc, V3 & color) const
 {
 	const float lightDotSize = 10.0f;
 	V3 projLightPos;
@@ -229,7 +633,10 @@ void Light::cleanShadowMaps(void)
 {
 	for (unsigned int i = 0; i < shadowMapsN; i++) {
 		shadowMapCube[i]->clearZB(0.0f);
-		shadowMapCube[i]->set(0xFFFFFFFF);
+		if (shadowColorMaps) {
+			shadowColorMaps[i]->clearZB(0.0f);
+			shadowColorMaps[i]->set(0xFFFFFFFF);
+		}
 	}
 }
 
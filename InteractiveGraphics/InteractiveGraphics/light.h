@@ -1,14 +1,20 @@
 #pragma once
 #include <vector>
 using std::vector;
+#include <utility>
+using std::pair;
 #include "v3.h"
 // Forward delcarations
+class SWRenderTarget;
+class SWDepthTarget;
 class SWFrameBuffer;
 class PPC;
 class TMesh;
 
 class Light
 {
+public:
+	static const unsigned int K_MAX_CASCADES = 4;
 protected:
 	bool isPointLgiht; // is point light vs directional light
 	bool isUsingCubemap; // cubemap is an option only for point lights
@@ -18,25 +24,112 @@ protected:
 	V3 matColor;
 	float ambientK;
 
-	SWFrameBuffer **shadowMapCube;
+	SWDepthTarget **shadowMapCube;
+	// color versions of the above, only made (and kept) once shadow maps
+	// get built with isDrawModeFlat false, which stealth mode reads colors from
+	SWRenderTarget **shadowColorMaps;
+#ifndef SW_HEADLESS
+	// windows for visual debugging of the shadow maps, only made on request
+	SWFrameBuffer **shadowMapWindows;
+#endif
 	PPC **shadowMapCams;
 	unsigned int shadowMapsN;
 	unsigned int shadowMapResWidth;
 	unsigned int shadowMapResHeight;
 	float shadowMapResHfov;
+	// shadow queries look at pcfKernelSize x pcfKernelSize shadow map
+	// texels (percentage closer filtering), 1 means hard shadows
+	int pcfKernelSize;
+	// depth test tolerance, keeps surfaces from shadowing themselves
+	float shadowEpsilon;
+
+	// cascaded shadow maps for directional lights: the view frustum of the
+	// rendering camera between cascadesNear and cascadesFar is split into
+	// cascadesN depth slices, each covered by its own shadow map so near
+	// receivers get small texels and far ones still get a shadow. Off (and
+	// nothing allocated) while cascadesN is 0
+	unsigned int cascadesN;
+	float cascadesNear, cascadesFar;
+	SWDepthTarget *cascadeMaps[K_MAX_CASCADES];
+	PPC *cascadeCams[K_MAX_CASCADES];
+	// view depth where cascade i starts (cascadeSplits[i]) and ends
+	float cascadeSplits[K_MAX_CASCADES + 1];
+	// depth test tolerance of the cascades in shadow map texels, which
+	// keeps the same meaning in every slice unlike shadowEpsilon
+	float cascadeBiasTexels;
+	// cascade cameras sit at different distances, so the depth test
+	// tolerance in 1/w is worked out per cascade from cascadeBiasTexels
+	float cascadeEpsilons[K_MAX_CASCADES];
+	// view direction of the camera the cascades were fitted to, its eye is
+	// in cascadesBuiltState
+	V3 cascadesViewDir;
+
+	// what the shadow maps were last built from. buildShadowMaps() does
+	// nothing while the light and every mesh (see TMesh::getVertsStamp)
+	// are still the same. Cascades also depend on the view camera
+	struct ShadowMapsState {
+		bool isValid;
+		V3 position, direction;
+		bool isUsingCubemap, isDrawModeFlat;
+		V3 viewEye, viewA, viewB, viewC;
+		vector<pair<const TMesh *, unsigned int>> meshStamps;
+	} builtState, cascadesBuiltState;
+	// viewCam only for cascades
+	bool isShadowMapsStateCurrent(const ShadowMapsState &state,
+		const vector<TMesh *> &tMeshArray, bool isDrawModeFlat,
+		const PPC *viewCam = nullptr) const;
+	void recordShadowMapsState(ShadowMapsState &state,
+		const vector<TMesh *> &tMeshArray, bool isDrawModeFlat,
+		const PPC *viewCam = nullptr) const;
 
+	void allocateShadowMaps(void);
+	void freeShadowMaps(void);
+	void allocateCascades(void);
+	void freeCascades(void);
 	void cleanShadowMaps(void);
 	void setUpShadowMapCams(void);
+	// fits cascade cameras around the slices of viewCam's frustum
+	void setUpCascadeCams(const PPC &viewCam, const vector<TMesh *> &tMeshArray);
+	// renders all meshes into mapsN depth only maps, in parallel
+	static void drawDepthMaps(SWDepthTarget *const *maps, PPC *const *cams,
+		unsigned int mapsN, const vector<TMesh *> &tMeshArray);
+	// cascade whose depth slice holds the given view depth, -1 if none
+	int getCascadeIndex(float viewDepth) const;
+	// PCF shadow factor of the point whose projection by a shadow camera
+	// is q (not divided by w yet, and maybe scaled by oneOverW), 0 when
+	// it falls outside the shadow map
+	float getShadowFactorFromMap(const SWDepthTarget &map, const V3 &q,
+		float oneOverW, float epsilon) const;
+#ifndef SW_HEADLESS
+	// copies shadow map i into its debug window and shows it
+	void showShadowMap(unsigned int i);
+#endif
 
 public:
+#ifndef SW_HEADLESS
+	// shadow maps default to the main scene camera resolution
 	Light(bool isPointLight = true, float hfov = 0.0f);
+#endif
+	// shadow maps of given resolution and field of view
+	Light(bool isPointLight, float hfov,
+		unsigned int resWidth, unsigned int resHeight);
 	~Light();
 
 	// return lit color for triangle vertex
 	V3 computeDiffuseContribution(const V3 &triangleVertex, const V3 &normal) const;
 	// return whether or not 3D point is in shadow casted by this light
 	bool isPointInShadow(const V3 &point) const;
-	// renders array of triangle meshes into shadow maps
+	// how much of 3D point is in shadow, from 0 (lit) to 1, filtered with
+	// the PCF kernel
+	float getShadowFactor(const V3 &point) const;
+	// getShadowFactor for the n pixel centers (u0 + i, v) of one row of
+	// cam's image, oneOverWs[i] being their 1/w. Shadow map coordinates are
+	// a projective linear function of the pixel so they are stepped along
+	// the row instead of unprojecting and projecting every pixel
+	void getShadowFactorSpan(const PPC &cam, float u0, float v,
+		const float *oneOverWs, int n, float *shadowFactors) const;
+	// renders array of triangle meshes into shadow maps, unless nothing
+	// changed since the last call. Cube map faces are built in parallel
 	// Note: Using vector as opposed to TMesh *TMeshArray or
 	// TMesh TMeshArray[] because the TMesh array is not generated at once
 	// but rather sporadically and therefore the memory for the array is not 
@@ -45,8 +138,28 @@ public:
 		vector<TMesh *> &tMeshArray,
 		bool isDbgShowShadowMaps = false,
 		bool isDrawModeFlat = true);
+	// shadow maps don't have to match the resolution of the camera the lit
+	// geometry is rendered with, only its field of view. Drops the current maps
+	void setShadowMapResolution(unsigned int resWidth, unsigned int resHeight);
+	unsigned int getShadowMapResWidth(void) const { return shadowMapResWidth; }
+	unsigned int getShadowMapResHeight(void) const { return shadowMapResHeight; }
+	// memory taken by the shadow maps of this light
+	size_t getShadowMapsSizeInBytes(void) const;
+	// renders array of triangle meshes into the shadow map cascades, fitted
+	// to the view frustum of viewCam, the camera the lit geometry is going
+	// to be rendered with. Same as buildShadowMaps() without cascades
+	void buildCascadedShadowMaps(vector<TMesh *> &tMeshArray, const PPC &viewCam);
+	// directional lights only, cascadesN up to K_MAX_CASCADES (0 turns
+	// cascades off). Slices split the view depth range [nearDistance,
+	// farDistance] between uniform and logarithmic steps; receivers beyond
+	// farDistance get no shadow
+	void setCascades(unsigned int newCascadesN, float nearDistance, float farDistance);
+	bool getIsCascadedOn(void) const { return cascadesN > 0; }
+	unsigned int getCascadesN(void) const { return cascadesN; }
+	// makes the next buildShadowMaps() call rebuild no matter what
+	void invalidateShadowMaps(void) { builtState.isValid = cascadesBuiltState.isValid = false; }
 	// draws itself for visual debug
-	void draw(SWFrameBuffer &fb, const PPC &ppc, V3 &color) const;
+	void draw(SWRenderTarget &fb, const PPC &ppc, V3 &color) const;
 
 	// getters
 	bool getIsPointLight(void) const { return isPointLgiht; }
@@ -63,5 +176,16 @@ public:
 	void setMatColor(const V3 &matCol) { matColor = matCol; }
 	void setAmbientK(float ka) { ambientK = ka; }
 	void setIsUsingCubemap(bool value) { isUsingCubemap = value; }
+	// odd kernel sizes keep the kernel centered, even ones get rounded up
+	void setPCFKernelSize(int size) { pcfKernelSize = (size < 1) ? 1 : (size | 1); }
+	int getPCFKernelSize(void) const { return pcfKernelSize; }
+	// depth test tolerance in 1/w of the single shadow map and the cube,
+	// cascades use setCascadeBias instead
+	void setShadowEpsilon(float epsilon) { shadowEpsilon = epsilon; }
+	float getShadowEpsilon(void) const { return shadowEpsilon; }
+	// depth test tolerance of the cascades in shadow map texels along the
+	// light, takes effect when the cascades get rebuilt next
+	void setCascadeBias(float texels) { cascadeBiasTexels = texels; cascadesBuiltState.isValid = false; }
+	float getCascadeBias(void) const { return cascadeBiasTexels; }
 };
 
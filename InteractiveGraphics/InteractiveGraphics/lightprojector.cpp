@@ -1,11 +1,22 @@
 #include "lightprojector.h"
 #include "ppc.h"
+#include "sw_rendertarget.h"
+#include "sw_depthtarget.h"
 
+#ifndef SW_HEADLESS
 LightProjector::LightProjector(const string & texFilename) :
 	Light(false) // call base class constructor for a directional light
 {
 	texObject = new Texture(texFilename);
 }
+#endif
+
+LightProjector::LightProjector(const string & texFilename, float hfov,
+	unsigned int resWidth, unsigned int resHeight) :
+	Light(false, hfov, resWidth, resHeight) // directional light
+{
+	texObject = new Texture(texFilename);
+}
 
 LightProjector::~LightProjector()
 {
@@ -73,7 +84,12 @@ bool LightProjector::getProjectedStealthColor(const V3 & point, unsigned int & o
 
 		// is hit by the light of this light projector
 
-		// get color from shadow map itself instead of texture
+		// get color from shadow map itself instead of texture, which is
+		// only there if it was built in stealth mode
+		if (shadowColorMaps == nullptr) {
+			outColor = 0x00000000;
+			return false;
+		}
 		// shadow map and shadow camera have the same resolution by construction
 		unsigned int u, v;
 		u = (unsigned int)(projP[0] + 0.5f); // round up >5 or down <5
@@ -81,7 +97,7 @@ bool LightProjector::getProjectedStealthColor(const V3 & point, unsigned int & o
 		unsigned int uv = (shadowMapCams[0]->getHeight() - v - 1) * 
 			shadowMapCams[0]->getWidth() + u;
 
-		outColor = shadowMapCube[0]->getPixAt(uv);
+		outColor = shadowColorMaps[0]->getPixAt(uv);
 		return true;
 	}
 	outColor = 0x00000000;
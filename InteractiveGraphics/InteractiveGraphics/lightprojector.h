@@ -6,7 +6,12 @@ class LightProjector :
 {
 	Texture *texObject;
 public:
+#ifndef SW_HEADLESS
 	LightProjector(const string &texFilename);
+#endif
+	// projector matching a camera other than the main scene one
+	LightProjector(const string &texFilename, float hfov,
+		unsigned int resWidth, unsigned int resHeight);
 	~LightProjector();
 
 	// output color needs to be unsigned int in order to also return the alpha
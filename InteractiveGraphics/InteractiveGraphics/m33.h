@@ -16,31 +16,31 @@ class M33 {
 private:
   V3 rows[3];
 public:
+	// as in V3, the small operators are defined inline below the class so
+	// that per pixel math doesn't pay for function calls
+	
 	// constructor from 3 3D vectors
-	M33(const V3 &row1, const V3 &row2, const V3 &row3);
+	constexpr M33(const V3 &row1, const V3 &row2, const V3 &row3) :
+		rows{ row1, row2, row3 } {}
 	// default constructor
-	M33();
+	constexpr M33() : rows{} {}
 
 	// copy constructor
-	// not really needed in this class since automatic shallow copies from
-	// compiler would be enough but it doesn't hurt to implement one as an exercise
-	// must receive a reference to prevent infinite recursions
-	M33(const M33 &matrixToCopy);
+	// compiler generated shallow copy is all this class needs
+	M33(const M33 &matrixToCopy) = default;
 
 	//~M33(); // Default constructor is ok since class doesn't deal with dynamic data
 
 	// overloaded assignment operator
-	// Again I'm only implemeting this as exercise. For this class, autogenerated
-	// behavior by compiler is probably good enough.
-	// const return avoids (m1=m2)=m3.
-	// (That is bad not only because is weird syntax but also 
-	// because m1 = m2 and m1 = m3 but m2 is never set in that case)
+	// autogenerated behavior by compiler is good enough for this class.
 	// return reference does allow for cascaded assignments such as m1 = m2 = m3
 	// (m1.operator=(m2.operator(m3)) is allowed and good syntax
-	const M33& operator=(const M33 &right);
+	M33& operator=(const M33 &right) = default;
 
 	// access to rows for reading and writing
-	V3& operator[](int i);
+	V3& operator[](int i) { return rows[i]; }
+	// access to rows for reading only
+	const V3& operator[](int i) const { return rows[i]; }
     
 	// multiplication with 3D vector
 	const V3 operator*(const V3 &vector) const;
@@ -67,4 +67,41 @@ public:
 	void setRotationAboutX(float theta);
 	void setRotationAboutY(float theta);
 	void setRotationAboutZ(float theta);
-};
\ No newline at end of file
+};
+
+// inline member function definitions
+
+inline const V3 M33::operator*(const V3 &vector) const {
+
+	// matrix vector mult implemented with dot products
+	return V3(rows[0] * vector, rows[1] * vector, rows[2] * vector);
+}
+
+inline const M33 M33::operator*(const M33 &matrix) const {
+
+	// matrix matrix multiplication implemented with dot products
+	V3 column0 = matrix.getColumn(0);
+	V3 column1 = matrix.getColumn(1);
+	V3 column2 = matrix.getColumn(2);
+	return M33(
+		V3(rows[0] * column0, rows[0] * column1, rows[0] * column2),
+		V3(rows[1] * column0, rows[1] * column1, rows[1] * column2),
+		V3(rows[2] * column0, rows[2] * column1, rows[2] * column2));
+}
+
+inline V3 M33::getColumn(int j) const {
+
+	return V3(rows[0][j], rows[1][j], rows[2][j]);
+}
+
+inline void M33::setColumn(const V3 &columnVector, int j) {
+
+	rows[0][j] = columnVector[0];
+	rows[1][j] = columnVector[1];
+	rows[2][j] = columnVector[2];
+}
+
+inline M33 M33::getTranspose(void) const {
+
+	return M33(getColumn(0), getColumn(1), getColumn(2));
+}
@@ -0,0 +1,99 @@
+#include "mappedfile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0)
+#ifdef _WIN32
+	,
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const char * fname)
+{
+	close();
+	fileHandle = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	// PAGE_WRITECOPY + FILE_MAP_COPY is the private copy on write mapping
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		close();
+		return false;
+	}
+	data = (unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, 0);
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close(void)
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::open(const char * fname)
+{
+	close();
+	int fd = ::open(fname, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void *mapping = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE, fd, 0);
+	// the mapping keeps the file referenced on its own
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+	data = (unsigned char*)mapping;
+	size = (size_t)fileStat.st_size;
+	return true;
+}
+
+void MappedFile::close(void)
+{
+	if (data)
+		munmap(data, size);
+	data = nullptr;
+	size = 0;
+}
+#endif
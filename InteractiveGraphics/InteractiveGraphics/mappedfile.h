@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+
+// Maps a whole file into memory so its contents can be used in place,
+// without reading them into buffers first. Pages only get loaded from disk
+// once touched. The mapping is private copy on write: data can be written
+// to, which makes a copy of just the touched pages for this process and
+// never changes the file.
+class MappedFile
+{
+	unsigned char *data;
+	size_t size;
+#ifdef _WIN32
+	void *fileHandle; // HANDLEs, spelled out so this header does not need windows.h
+	void *mappingHandle;
+#endif
+
+	// no copies, the mapping is owned
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+public:
+	MappedFile();
+	~MappedFile();
+
+	// maps fname, returns false (and maps nothing) if it can't. Empty files
+	// can't be mapped
+	bool open(const char *fname);
+	// unmaps, pointers into data are invalid afterwards
+	void close(void);
+
+	bool getIsOpen(void) const { return data != nullptr; }
+	unsigned char *getData(void) const { return data; }
+	size_t getSize(void) const { return size; }
+};
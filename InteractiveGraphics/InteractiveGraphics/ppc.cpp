@@ -9,10 +9,20 @@ using std::ofstream;
 using std::ifstream;
 #include <cstdlib>
 using std::exit;
+#ifndef SW_HEADLESS
 #include <GL\glut.h> // needed for GLU.h inclusion
 #include <GL\GLU.h> // needed for glLookAt definition
+#endif
 #include "ppc.h"
 
+// SSE2 is baseline for x64 and the default /arch for x86 since VS2012
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PPC_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define PPC_USE_SSE 0
+#endif
+
 void PPC::buildProjM(void)
 {
 	// three equations, three unknowns (look at slide 8 in PHC.pdf)
@@ -48,6 +58,27 @@ V3 PPC::getViewDir(void) const
 	return returnVector;
 }
 
+void PPC::getFrustumPlanes(V3 * const planeNormals) const
+{
+	// rays from the eye through the four image corners
+	V3 topLeft = c;
+	V3 topRight = c + a * (float)w;
+	V3 bottomLeft = c + b * (float)h;
+	V3 bottomRight = c + a * (float)w + b * (float)h;
+	// and one through the image center to tell inside from outside
+	V3 center = c + a * ((float)w / 2.0f) + b * ((float)h / 2.0f);
+
+	planeNormals[0] = topLeft ^ bottomLeft; // left
+	planeNormals[1] = bottomRight ^ topRight; // right
+	planeNormals[2] = topRight ^ topLeft; // top
+	planeNormals[3] = bottomLeft ^ bottomRight; // bottom
+	planeNormals[4] = a ^ b; // image plane direction through C
+	for (int pi = 0; pi < K_FRUSTUM_PLANES_N; pi++) {
+		if (planeNormals[pi] * center < 0.0f)
+			planeNormals[pi] = planeNormals[pi] * -1.0f;
+	}
+}
+
 float PPC::getFocalLength(void) const
 {
 	// this is the distance from center of projection to eye position and its
@@ -271,7 +302,7 @@ void PPC::setByInterpolation(PPC  &ppc0, PPC &ppc1, int i, int n)
 	buildProjM();
 }
 
-void PPC::visualizeCamera(const PPC & visCam, SWFrameBuffer & fb, float visF)
+void PPC::visualizeCamera(const PPC & visCam, SWRenderTarget & fb, float visF)
 {
 	float scf = visF / getFocalLength();
 	V3 c0(0.0f, 0.2f, 1.0f);
@@ -330,6 +361,7 @@ void PPC::visualizeCamera(const PPC & visCam, SWFrameBuffer & fb, float visF)
 	fb.draw2DSegment(projv0, c0, projv1, c1);
 }
 
+#ifndef SW_HEADLESS
 void PPC::setGLIntrinsics(float nearValue, float farValue) const
 {
 	glViewport(0, 0, w, h);
@@ -419,6 +451,7 @@ void PPC::setGLExtrinsics(void) const
 		lap[0], lap[1], lap[2], 
 		up[0], up[1], up[2]);
 }
+#endif
 
 // projects given point, returns false if point behind head
 bool PPC::project(const V3 &P, V3& projP) const {
@@ -438,6 +471,69 @@ bool PPC::project(const V3 &P, V3& projP) const {
 	return true;
 }
 
+void PPC::projectBatch(const float * xs, const float * ys, const float * zs,
+	int pointsN, V3 * projPs, bool * isProjValid) const
+{
+	// same math as project(), with the rows of projM and C fetched only once
+	float m[3][3];
+	for (int j = 0; j < 3; j++) {
+		V3 column = projM.getColumn(j);
+		m[0][j] = column.getX();
+		m[1][j] = column.getY();
+		m[2][j] = column.getZ();
+	}
+	int pi = 0;
+
+#if PPC_USE_SSE
+	__m128 cx = _mm_set1_ps(C.getX());
+	__m128 cy = _mm_set1_ps(C.getY());
+	__m128 cz = _mm_set1_ps(C.getZ());
+	__m128 mr[3][3];
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++)
+			mr[i][j] = _mm_set1_ps(m[i][j]);
+	}
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	float projU[4], projV[4], projOneOverW[4];
+	for (; pi < pointsN; pi += 4) {
+		__m128 dx = _mm_sub_ps(_mm_load_ps(xs + pi), cx);
+		__m128 dy = _mm_sub_ps(_mm_load_ps(ys + pi), cy);
+		__m128 dz = _mm_sub_ps(_mm_load_ps(zs + pi), cz);
+		__m128 q[3];
+		for (int i = 0; i < 3; i++) {
+			q[i] = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(mr[i][0], dx), _mm_mul_ps(mr[i][1], dy)), _mm_mul_ps(mr[i][2], dz));
+		}
+		// no projection for points behind camera or exactly at C
+		int validMask = _mm_movemask_ps(_mm_cmpgt_ps(q[2], zero));
+		_mm_storeu_ps(projU, _mm_div_ps(q[0], q[2]));
+		_mm_storeu_ps(projV, _mm_div_ps(q[1], q[2]));
+		_mm_storeu_ps(projOneOverW, _mm_div_ps(one, q[2]));
+		for (int lane = 0; lane < 4 && pi + lane < pointsN; lane++) {
+			isProjValid[pi + lane] = (validMask & (1 << lane)) != 0;
+			if (isProjValid[pi + lane])
+				projPs[pi + lane] = V3(projU[lane], projV[lane], projOneOverW[lane]);
+		}
+	}
+#endif
+
+	// whatever is left when not vectorized
+	for (; pi < pointsN; pi++) {
+		float dx = xs[pi] - C.getX();
+		float dy = ys[pi] - C.getY();
+		float dz = zs[pi] - C.getZ();
+		float qw = m[2][0] * dx + m[2][1] * dy + m[2][2] * dz;
+		isProjValid[pi] = (qw > 0.0f);
+		if (!isProjValid[pi])
+			continue;
+		projPs[pi] = V3(
+			(m[0][0] * dx + m[0][1] * dy + m[0][2] * dz) / qw,
+			(m[1][0] * dx + m[1][1] * dy + m[1][2] * dz) / qw,
+			1.0f / qw);
+	}
+}
+
 V3 PPC::unproject(const V3 & projP) const
 {
 	// From projection of point formula we know
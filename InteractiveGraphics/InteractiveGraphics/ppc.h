@@ -1,7 +1,7 @@
 #pragma once
 #include "v3.h"
 #include "m33.h"
-#include "sw_framebuffer.h"
+#include "sw_rendertarget.h"
 #include <string>
 using std::string;
 
@@ -35,6 +35,8 @@ public:
 	V3 getLowerCaseC(void) const { return c; }
 	// get eyepoint
 	V3 getEyePoint(void) const { return C; }
+	// get projection matrix, project() computes projM * (P - C)
+	const M33 &getProjM(void) const { return projM; }
 	// get view direction
 	V3 getViewDir(void) const;
 	// get focal length
@@ -50,6 +52,12 @@ public:
 	// get principal point (image coordinates of C projection onto the plane)
 	// z component is always zero
 	V3 getPrincipalPoint(void) const;
+	// view frustum planes, all going through eye point C: left, right,
+	// top, bottom and last the plane containing C parallel to the image
+	// plane (points in front of that one are the only ones project() accepts).
+	// Normals point inside the frustum, they are not normalized.
+	static const int K_FRUSTUM_PLANES_N = 5;
+	void getFrustumPlanes(V3 *const planeNormals) const;
 
 	// camera translations only affect C vector. a, b, and c remain intact
 	void translate(const V3 &transVector); // move eye using translation vector
@@ -78,20 +86,36 @@ public:
 
 	// projection of 3D point
 	bool project(const V3 &P, V3& projP) const;
+	// projection of pointsN 3D points given as structure of arrays, same
+	// results as calling project() on each. xs, ys and zs must be 16 byte
+	// aligned and readable up to pointsN rounded up to a multiple of 4
+	void projectBatch(const float *xs, const float *ys, const float *zs,
+		int pointsN, V3 *projPs, bool *isProjValid) const;
 	// unproject a 2D point (u,v,1/w) previously projected by this camera
 	V3 unproject(const V3 &projP) const;
 
+	// same view: same intrinsics, pose and resolution, so anything
+	// projected by one camera is also what the other one would give
+	bool operator==(const PPC &other) const
+	{
+		return a == other.a && b == other.b && c == other.c &&
+			C == other.C && w == other.w && h == other.h;
+	}
+	bool operator!=(const PPC &other) const { return !(*this == other); }
+
 	// interpolation between two given cameras
 	// sets this camera to the ith camera out of n between the 
 	// interpolated result between ppc0 and ppc1
 	void setByInterpolation(PPC &ppc0, PPC &ppc1, int i, int n);
 
 	// draw camera frustum in wireframe, adapt focal length to visF
-	void visualizeCamera(const PPC &visCam, SWFrameBuffer &fb, float visF);
+	void visualizeCamera(const PPC &visCam, SWRenderTarget &fb, float visF);
 
 	// add optional support for HW rendering through OpenGL
+#ifndef SW_HEADLESS
 	void setGLIntrinsics(float nearValue, float farValue) const;
 	void setGLExtrinsics(void) const;
+#endif
 
 	// save load from text file
 	void saveCameraToFile(string fName) const;
@@ -422,6 +422,7 @@ void Scene::testRaster() {
 		tProjVerts[1][0] -= steps;
 		tProjVerts[2][0] -= steps;
 		fb->draw2DFlatTriangle(tProjVerts, triangleColor);
+		fb->flushTiles(); // no-op unless tiled rendering is on
 		fb->redraw();
 		Fl::check();
 	}
@@ -451,6 +452,7 @@ void Scene::testCameraLerp(void)
 
 		ppc->setByInterpolation(*ppcLerp0, *ppcLerp1, i, n);
 		drawTMesh(*tms[0], *fb, *ppc, true);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 //		Fl::wait(0.09);	
@@ -505,6 +507,7 @@ void Scene::testCameraControl(void)
 	else
 		fb->clearZB(0.0f);
 	drawTMesh(*tms[0], *fb, *ppc, true);
+	fb->resolveDeferredShading();
 	fb->redraw();
 	return;
 }
@@ -598,6 +601,7 @@ void Scene::a2Demo()
 		for (int i = 0; i < 5; i++)
 			drawTMesh(*tms[i], *fb, *ppc, true);
 
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 		// rotate teapots
@@ -873,6 +877,9 @@ void Scene::testSprites(void)
 		texObjects[0] = new Texture("pngs\\T_Explosion_SubUV.png");
 		texObjects[1] = new Texture("pngs\\Bride-sprite-sheet.png");
 		texObjects[2] = new Texture("pngs\\FireTorchSpriteAtlas.png");
+		// bilinear filtered sprites need the alpha preserving filter
+		for (int n = 0; n < 3; n++)
+			texObjects[n]->setIsFixedPointFilteringOn(true);
 		this->isSpriteTestInit = true;
 	}
 	// draw explosion animated sprite
@@ -1039,6 +1046,7 @@ void Scene::testShadowMap(void)
 	// enable shadow mapping
 	drawTMesh(*tms[0], *fb, *ppc, false, true, false);
 	drawTMesh(*tms[1], *fb, *ppc, false, true, false);
+	fb->resolveDeferredShading();
 	fb->redraw();
 	return;
 }
@@ -1107,6 +1115,7 @@ void Scene::testTexProj(void)
 	// enable shadow mapping for the quad
 	drawTMesh(*tms[0], *fb, *ppc, false, true, true);
 	drawTMesh(*tms[1], *fb, *ppc, false, true, true);
+	fb->resolveDeferredShading();
 	fb->redraw();
 	return;
 }
@@ -1229,6 +1238,7 @@ void Scene::testA4Demo(void)
 			nullptr, false, true, false);
 		tms[2]->drawLit(*fb, *ppc, *light, lightProjector,
 			nullptr, false, true, false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1278,6 +1288,7 @@ void Scene::testA4Demo(void)
 		// draw auditorium mesh in lit mode + colors + shadowmap + projective texturing
 		tms[3]->drawLit(*fb, *ppc, *light, lightProjector,
 			nullptr, true, false, true);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1506,6 +1517,7 @@ void Scene::testCubeMapReflection(void)
 	fb->clearZB(0.0f);
 	tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, true);
 	tms[1]->drawReflective(cubeMap, *fb, *ppc, texObjects[0], false);
+	fb->resolveDeferredShading();
 	fb->redraw();
 	return;
 }
@@ -1549,6 +1561,7 @@ void Scene::testCubeMapRefraction(void)
 	tms[0]->drawRefractive(nl, nt, cubeMap, *fb, *ppc, nullptr, false);
 	//tms[1]->drawRefractive(nl, nt, cubeMap, *fb, *ppc, texObjects[0], false);
 	//tms[1]->drawRefractive(nl, nt, cubeMap, *fb, *ppc, nullptr, false);
+	fb->resolveDeferredShading();
 	fb->redraw();
 	return;
 }
@@ -1602,6 +1615,7 @@ void Scene::a5Demo(void)
 		fb->clearZB(0.0f);
 		// draw teapot
 		tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, true);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1626,6 +1640,7 @@ void Scene::a5Demo(void)
 		fb->clearZB(0.0f);
 		// draw teapot
 		tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1652,6 +1667,7 @@ void Scene::a5Demo(void)
 		tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, true);
 		// draw textured quad (useful when implementing billboard reflection raytracing)
 		//tms[1]->drawReflective(cubeMap, *fb, *ppc, texObjects[0], false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1674,6 +1690,7 @@ void Scene::a5Demo(void)
 		fb->clearZB(0.0f);
 		// draw teapot
 		tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1696,6 +1713,7 @@ void Scene::a5Demo(void)
 		fb->clearZB(0.0f);
 		// draw teapot
 		tms[0]->drawReflective(cubeMap, *fb, *ppc, nullptr, false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1722,6 +1740,7 @@ void Scene::a5Demo(void)
 		fb->clearZB(0.0f);
 		// draw teapot
 		tms[0]->drawRefractive(nl, nt, cubeMap, *fb, *ppc, nullptr, false);
+		fb->resolveDeferredShading();
 		fb->redraw();
 		Fl::check();
 #ifdef _MAKE_VIDEO_
@@ -1803,6 +1822,7 @@ void Scene::testFixedPipelineHW(void)
 		fb->clearZB(0.0f);
 	drawTMesh(*tms[0], *fb, *ppc, true);
 
+	fb->resolveDeferredShading();
 	fb->redraw();
 	fixedHwFb->redraw();
 	return;
@@ -1877,6 +1897,7 @@ void Scene::testProgrPipelineHW(void)
 		fb->clearZB(0.0f);
 	drawTMesh(*tms[0], *fb, *ppc, true);
 
+	fb->resolveDeferredShading();
 	fb->redraw();
 	progrHwFb->redraw();
 	return;
@@ -2,6 +2,7 @@
 #include <string>
 using std::string;
 #include "gui.h"
+#include "drawmodes.h"
 // forward declaration here to prevent glew include
 // sensibilities
 class HWFrameBuffer;
@@ -32,15 +33,6 @@ enum class Scenes {
 	A6,
 	A6_2};
 
-enum class DrawModes { 
-	DOTS, 
-	WIREFRAME, 
-	FLAT, 
-	SCREENSCAPELERP, 
-	MODELSPACELERP, 
-	TEXTURE,
-	LIT};
-
 class Scene {
 private:
 	SWFrameBuffer *fb; // SW framebuffer
@@ -135,6 +127,7 @@ public:
 	void setMouseRoll(int mouseRoll);
 
 	PPC* getCamera(void) { return ppc; }
+	Light* getLight(void) { return light; }
 
 	static const float K_HFOV; // field of view
 	static const int K_W; // window height and width
@@ -0,0 +1,124 @@
+#include "sw_depthtarget.h"
+#include "sw_rendertarget.h"
+#include "aabb.h"
+#include "edgeeval.h"
+#include <algorithm>
+#include <cmath>
+using std::min;
+using std::max;
+
+SWDepthTarget::SWDepthTarget(unsigned int _w, unsigned int _h) :
+	w(_w),
+	h(_h)
+{
+	zb = new float[_w * _h];
+}
+
+SWDepthTarget::~SWDepthTarget()
+{
+	delete[] zb;
+}
+
+void SWDepthTarget::clearZB(float farz)
+{
+	std::fill(zb, zb + (size_t)w * h, farz);
+}
+
+void SWDepthTarget::draw2DTriangleDepth(const V3 * const pvs, int rowsTop, int rowsBottom)
+{
+	// same pixel coverage and 1/w as SWRenderTarget::draw2DFlatTriangleWithDepth,
+	// minus everything that has to do with color
+	AABB aabb(pvs[0]);
+	aabb.AddPoint(pvs[1]);
+	aabb.AddPoint(pvs[2]);
+	if (!aabb.clipWithFrame(0.0f, (float)max(rowsTop, 0), (float)w, (float)min(rowsBottom, h)))
+		return;
+
+	int left, right, top, bottom;
+	aabb.setPixelRectangle(left, right, top, bottom);
+
+	SWRenderTarget::TriangleSetup setup;
+	SWRenderTarget::computeTriangleSetup(pvs, setup);
+	EdgeEvaluator edgeEval(setup.eeqs, setup.depthABC);
+	float quadDepth[EdgeEvaluator::K_QUAD_W];
+
+	for (int blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (int blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+			int blockLeft = max(blockU, left);
+			int blockTop = max(blockV, top);
+			int blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			int blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			EdgeEvaluator::BlockCoverage blockCoverage =
+				edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue;
+			bool isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (int v = blockTop; v <= blockBottom; v++) {
+				edgeEval.setRow(v);
+				float *zbRow = &zb[(h - 1 - v)*w];
+				for (int quadU = blockU; quadU <= blockRight; quadU += EdgeEvaluator::K_QUAD_W) {
+					int quadMask = edgeEval.computeQuadMask(quadU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask != 0)
+						EdgeEvaluator::maskedStoreQuad(zbRow, w, quadU, quadMask, quadDepth);
+				}
+			}
+		}
+	}
+}
+
+bool SWDepthTarget::isDepthTestPass(const V3 & p, float epsilon) const
+{
+	if ((p.getX() < 0.0f) || (p.getX() >= w) ||
+		(p.getY() < 0.0f) || (p.getY() >= h))
+		return false;
+
+	int u = (int)p.getX();
+	int v = (int)p.getY();
+	// see SWRenderTarget::isDepthTestPass on epsilon
+	float zBufferValue = zb[(h - 1 - v)*w + u];
+	if (fabsf(zBufferValue - p.getZ()) < epsilon)
+		return true;
+	return zBufferValue < p.getZ();
+}
+
+float SWDepthTarget::getPCFShadowFactor(const V3 & p, float epsilon, int kernelSize) const
+{
+	int u = (int)p.getX();
+	int v = (int)p.getY();
+	float z = p.getZ();
+	int radius = kernelSize / 2;
+	int shadowedN = 0;
+	for (int kv = v - radius; kv <= v + radius; kv++) {
+		const float *zbRow = &zb[(h - 1 - min(max(kv, 0), h - 1))*w];
+		for (int ku = u - radius; ku <= u + radius; ku++) {
+			float zBufferValue = zbRow[min(max(ku, 0), w - 1)];
+			// isDepthTestPass failing
+			if (fabsf(zBufferValue - z) >= epsilon && zBufferValue >= z)
+				shadowedN++;
+		}
+	}
+	return (float)shadowedN / (float)((2 * radius + 1) * (2 * radius + 1));
+}
+
+void SWDepthTarget::copyZB(const SWRenderTarget & fb)
+{
+	if (fb.getWidth() != w || fb.getHeight() != h)
+		return;
+	for (unsigned int i = 0; i < (unsigned int)(w * h); i++)
+		zb[i] = fb.getZbAt(i);
+}
+
+void SWDepthTarget::drawAsGrayLevels(SWRenderTarget & fb) const
+{
+	float maxZ = 0.0f;
+	for (int i = 0; i < w * h; i++)
+		maxZ = max(maxZ, zb[i]);
+	for (int v = 0; v < min(h, fb.getHeight()); v++) {
+		for (int u = 0; u < min(w, fb.getWidth()); u++) {
+			float z = zb[(h - 1 - v)*w + u];
+			V3 gray(1.0f, 1.0f, 1.0f);
+			gray = gray * ((maxZ > 0.0f) ? z / maxZ : 0.0f);
+			fb.set(u, v, gray.getColor());
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "v3.h"
+#include <cstddef>
+class SWRenderTarget; // need forward declaration here
+
+// Depth only render target for shadow maps. Holds a z buffer of 1/w and
+// nothing else (a SWRenderTarget also has the color buffer, half the
+// memory of a shadow map nobody looks at) and can have any resolution, it
+// only has to match the camera it gets rendered with. Same z buffer layout
+// and depth test as SWRenderTarget.
+class SWDepthTarget
+{
+	int w, h;
+	float *zb; // bottom row first, like SWRenderTarget::zb
+
+	// no copies, zb is owned
+	SWDepthTarget(const SWDepthTarget &) = delete;
+	SWDepthTarget &operator=(const SWDepthTarget &) = delete;
+public:
+	SWDepthTarget(unsigned int _w, unsigned int _h);
+	~SWDepthTarget();
+
+	int getWidth(void) const { return w; }
+	int getHeight(void) const { return h; }
+	// z buffer memory
+	size_t getSizeInBytes(void) const { return sizeof(float) * (size_t)w * (size_t)h; }
+
+	// clear z buffer to far distance
+	void clearZB(float farz);
+	// depth only rasterizer: writes the screen space interpolated 1/w of
+	// the triangle with projected vertices pvs where it is closer than zb.
+	// Only rows [rowsTop, rowsBottom) are touched so several threads can
+	// fill one target, each with its own band of rows
+	void draw2DTriangleDepth(const V3 *const pvs, int rowsTop, int rowsBottom);
+	// same test as SWRenderTarget::isDepthTestPass
+	bool isDepthTestPass(const V3 &p, float epsilon) const;
+	// percentage closer filtering: fraction of the kernelSize x kernelSize
+	// texels around p (which has to be inside) that fail the depth test
+	// above, i.e. how much of p is in shadow. Kernel clamps at the borders
+	float getPCFShadowFactor(const V3 &p, float epsilon, int kernelSize) const;
+	// takes over the z buffer of a render target of the same resolution
+	// (shadow maps that also need colors get rendered into one of those)
+	void copyZB(const SWRenderTarget &fb);
+	// shows 1/w as gray levels, near is white, for visual debug
+	void drawAsGrayLevels(SWRenderTarget &fb) const;
+};
@@ -0,0 +1,2178 @@
+#include "sw_rendertarget.h"
+#include "lodepng.h"
+#include "ppc.h"
+#include "aabb.h"
+#include "cubemap.h"
+#include "workerpool.h"
+#include "edgeeval.h"
+#include <iostream>
+#include <math.h>
+#include <cfloat> // using FLT_MAX
+#include <cstring> // using memcpy
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// framebuffer the current thread is rasterizing a tile of in flushTiles(),
+// nullptr otherwise. Other framebuffers (e.g. shadow maps) touched while
+// shading are not affected
+static thread_local const SWRenderTarget *currentTileOwner = nullptr;
+
+// texture level of detail at a pixel of a triangle with perspective correct
+// s,t. s = sNum / den, so ds/du = (sNum.A - s * den.A) / den, same for v and t
+static inline float computePerspCorrectLod(const Texture &texture,
+	const V3 &sNumABC, const V3 &tNumABC, const V3 &denDEF,
+	float s, float t, float den)
+{
+	return texture.computeLod(
+		(sNumABC[0] - s * denDEF[0]) / den,
+		(tNumABC[0] - t * denDEF[0]) / den,
+		(sNumABC[1] - s * denDEF[1]) / den,
+		(tNumABC[1] - t * denDEF[1]) / den);
+}
+
+SWRenderTarget::SWRenderTarget(unsigned int _w, unsigned int _h) :
+	w(_w),
+	h(_h),
+	isEarlyDepthTestOn(false),
+	isHiZValid(false),
+	isDeferredShadingOn(false),
+	isMipMappingOn(true),
+	envMapCacheStamp(0),
+	isTiledRenderingOn(false)
+{
+	pix = new unsigned int[_w * _h];
+	zb = new float[_w * _h];
+	tilesU = (_w + K_TILE_SIZE - 1) / K_TILE_SIZE;
+	tilesV = (_h + K_TILE_SIZE - 1) / K_TILE_SIZE;
+}
+
+SWRenderTarget::~SWRenderTarget()
+{
+	delete[] pix;
+	delete[] zb;
+}
+
+unsigned int SWRenderTarget::getPixAt(unsigned int index) const
+{
+	if (pix)
+		return pix[index];
+	else
+		return 0;
+}
+
+float SWRenderTarget::getZbAt(unsigned int index) const
+{
+	if (zb)
+		return zb[index];
+	else
+		return 0.0f;
+}
+
+// clear to background color
+void SWRenderTarget::set(unsigned int color) {
+
+	for (int i = 0; i < w*h; i++) {
+		pix[i] = color;
+	}
+
+}
+
+void SWRenderTarget::clearZB(float farz)
+{
+	for (int i = 0; i < w*h; i++) {
+		zb[i] = farz;
+	}
+
+	if (isEarlyDepthTestOn) {
+		for (size_t level = 0; level < hiZ.size(); level++) {
+			for (size_t i = 0; i < hiZ[level].size(); i++)
+				hiZ[level][i] = farz;
+		}
+		isHiZValid = true;
+	}
+
+	if (isDeferredShadingOn)
+		clearGBuffer();
+}
+
+// set pixel with coordinates u v to color provided as parameter
+void SWRenderTarget::setSafe(int u, int v, unsigned int color) {
+
+	if (u < 0 || u > w - 1 || v < 0 || v > h - 1)
+		return;
+
+	set(u, v, color);
+
+}
+
+void SWRenderTarget::set(int u, int v, unsigned int color) {
+
+	pix[(h - 1 - v)*w + u] = color;
+
+}
+
+// set to checkboard
+void SWRenderTarget::setCheckerboard(int checkerSize, unsigned int color0,
+	unsigned int color1) {
+
+	for (int v = 0; v < h; v++) {
+		for (int u = 0; u < w; u++) {
+			int cu = u / checkerSize;
+			int cv = v / checkerSize;
+			if (((cu + cv) % 2) == 0) {
+				set(u, v, color0);
+			}
+			else {
+				set(u, v, color1);
+			}
+		}
+	}
+
+}
+
+// sets pixel at p[0], p[1] to color c if and only if 
+// p[2] is closer than zb value at that pixel
+void SWRenderTarget::setIfOneOverWCloser(const V3 & p, const V3 & c)
+{
+	if ((p.getX() < 0.0f) || (p.getX() >= w) ||
+		(p.getY() < 0.0f) || (p.getY() >= h))
+		return;
+
+	int u = (int)p.getX();
+	int v = (int)p.getY();
+
+	// remember that the z component of the projected point is 1/z or 1/w
+	if (zb[(h - 1 - v)*w + u] >= p.getZ())
+		return; // nothing to draw, already saw a surface closer at that pixel
+
+	zb[(h - 1 - v)*w + u] = p.getZ(); // set z at pixel to new closest surface value
+	set(u, v, c.getColor());
+	if (isDeferredShadingOn) // forward shaded surface now hides deferred one
+		gBuffer[(h - 1 - v)*w + u].materialId = K_NO_MATERIAL;
+}
+
+void SWRenderTarget::setIfWCloser(const V3 & p, const V3 & c)
+{
+	if ((p.getX() < 0.0f) || (p.getX() >= w) ||
+		(p.getY() < 0.0f) || (p.getY() >= h))
+		return;
+
+	int u = (int)p.getX();
+	int v = (int)p.getY();
+
+	// remember that here we are assuming the z component of the point passed is
+	// w instead of 1/w. This is produced by the perspective correct linear interpolation
+	// due to 1/w not being linear in model space but in screen space and w not being 
+	// linear in screen space but in model space
+	if (zb[(h - 1 - v)*w + u] <= p.getZ())
+		return; // nothing to draw, already saw a surface closer at that pixel
+
+	zb[(h - 1 - v)*w + u] = p.getZ(); // set z at pixel to new closest surface value
+	set(u, v, c.getColor());
+}
+
+void SWRenderTarget::setGBufferTexel(int u, int v, float oneOverW, const V3 & color,
+	const V3 & normal, float s, float t, float lod, int materialId)
+{
+	// caller already did the depth test
+	zb[(h - 1 - v)*w + u] = oneOverW;
+	GBufferTexel &texel = gBuffer[(h - 1 - v)*w + u];
+	texel.color = color;
+	texel.normal = normal;
+	texel.s = s;
+	texel.t = t;
+	texel.lod = lod;
+	texel.materialId = materialId;
+}
+
+bool SWRenderTarget::isDepthTestPass(const V3 & p, float epsilon)
+{
+	if ((p.getX() < 0.0f) || (p.getX() >= w) ||
+		(p.getY() < 0.0f) || (p.getY() >= h))
+		return false;
+
+	int u = (int)p.getX();
+	int v = (int)p.getY();
+
+	// remember that the z component of the projected point is 1/z or 1/w
+	float zBufferValue = zb[(h - 1 - v)*w + u];
+	// compute epsilon difference to make sure we are not talking about the
+	// same 3D point. In other words, prevent a 3D point from occluding itself
+	// in shadow by looking at itself in the shadowmap 'mirror' sort of speak.
+	float difference = abs(zBufferValue - p.getZ());
+	if (difference < epsilon) {
+		return true;
+	}
+	else if (zBufferValue >= p.getZ())
+		return false;
+	else
+		return true;
+}
+
+void SWRenderTarget::setIsTiledRenderingOn(bool value)
+{
+	// don't leave anything behind in the bins when switching modes
+	if (isTiledRenderingOn && !value)
+		flushTiles();
+	isTiledRenderingOn = value;
+	if (isTiledRenderingOn && tileBins.empty())
+		tileBins.resize(tilesU * tilesV);
+}
+
+bool SWRenderTarget::setUpRasterTriangle(RasterTriangle::RasterizerType type,
+	const V3 * const pvs, const TriangleSetup * setup, RasterTriangle & tri)
+{
+	// compute screen axes-aligned bounding box for triangle 
+	// clipping against SWFramebuffer
+	AABB aabb(pvs[0]);
+	aabb.AddPoint(pvs[1]);
+	aabb.AddPoint(pvs[2]);
+	if (!aabb.clipWithFrame(0.0f, 0.0f, (float)w, (float)h))
+		return false;
+	aabb.setPixelRectangle(tri.left, tri.right, tri.top, tri.bottom);
+	if (tri.left > tri.right || tri.top > tri.bottom)
+		return false; // doesn't cover any pixel center
+
+	bool isDepthTested = (type != RasterTriangle::FLAT && type != RasterTriangle::MODEL_SPACE);
+	if (!isDepthTested) {
+		// FLAT has no depth test and MODEL_SPACE interpolates depth in
+		// model space, the edge expressions are all they need
+		computeEdgeEquations(pvs, tri.setup.eeqs);
+	}
+	else {
+		// edge expressions and screen space interpolation of 1/w,
+		// unless the caller already had them
+		if (setup != nullptr)
+			tri.setup = *setup;
+		else
+			computeTriangleSetup(pvs, tri.setup);
+		// early depth test for the triangle as a whole. Binned triangles get
+		// it per tile in flushTiles(), zb will have changed by then
+		if (isEarlyDepthTestOn && !isTiledRenderingOn &&
+			isTriangleOccluded(tri.setup, tri.left, tri.right, tri.top, tri.bottom))
+			return false;
+	}
+
+	tri.type = type;
+	tri.pvs[0] = pvs[0];
+	tri.pvs[1] = pvs[1];
+	tri.pvs[2] = pvs[2];
+	tri.material = {};
+	tri.materialId = K_NO_MATERIAL;
+	return true;
+}
+
+void SWRenderTarget::submitTriangle(const RasterTriangle & tri)
+{
+	if (!isTiledRenderingOn) {
+		rasterizeTriangle(tri, tri.left, tri.right, tri.top, tri.bottom);
+		return;
+	}
+
+	unsigned int triangleIndex = (unsigned int)binnedTriangles.size();
+	binnedTriangles.push_back(tri);
+	for (int tv = tri.top / K_TILE_SIZE; tv <= tri.bottom / K_TILE_SIZE; tv++) {
+		for (int tu = tri.left / K_TILE_SIZE; tu <= tri.right / K_TILE_SIZE; tu++) {
+			tileBins[tv * tilesU + tu].push_back(triangleIndex);
+		}
+	}
+}
+
+void SWRenderTarget::flushTiles(void)
+{
+	if (binnedTriangles.empty())
+		return;
+
+	WorkerPool::getShared().parallelFor(tilesU * tilesV, [this](int tileIndex) {
+		vector<unsigned int> &bin = tileBins[tileIndex];
+		if (bin.empty())
+			return;
+		int tu = tileIndex % tilesU;
+		int tv = tileIndex / tilesU;
+		currentTileOwner = this;
+		int tileLeft = tu * K_TILE_SIZE, tileRight = min((tu + 1) * K_TILE_SIZE, w) - 1;
+		int tileTop = tv * K_TILE_SIZE, tileBottom = min((tv + 1) * K_TILE_SIZE, h) - 1;
+		// submission order is preserved within a tile, which keeps
+		// ties in the z test and alpha sprites looking the same as
+		// in the non tiled mode
+		for (size_t i = 0; i < bin.size(); i++) {
+			const RasterTriangle &tri = binnedTriangles[bin[i]];
+			// setup is done, only the part inside the tile is left to do
+			int left = max(tri.left, tileLeft), right = min(tri.right, tileRight);
+			int top = max(tri.top, tileTop), bottom = min(tri.bottom, tileBottom);
+			if (left > right || top > bottom)
+				continue;
+			if (isEarlyDepthTestOn && tri.type != RasterTriangle::FLAT &&
+				tri.type != RasterTriangle::MODEL_SPACE &&
+				isTriangleOccluded(tri.setup, left, right, top, bottom))
+				continue;
+			rasterizeTriangle(tri, left, right, top, bottom);
+		}
+		currentTileOwner = nullptr;
+		bin.clear();
+	});
+	binnedTriangles.clear();
+
+	// workers only kept the Hi-Z levels inside their own tile up to date
+	if (isEarlyDepthTestOn) {
+		int level = 0;
+		while ((EdgeEvaluator::K_BLOCK_SIZE << level) < K_TILE_SIZE)
+			level++;
+		buildHiZ(level + 1);
+	}
+}
+
+void SWRenderTarget::rasterizeTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	switch (tri.type) {
+	case RasterTriangle::FLAT:
+		rasterizeFlatTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::SCREEN_SPACE:
+		rasterizeScreenSpaceTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::MODEL_SPACE:
+		rasterizeModelSpaceTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::TEXTURED:
+		rasterizeTexturedTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::SPRITE:
+		rasterizeSprite(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::LIT:
+		rasterizeLitTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::FLAT_WITH_DEPTH:
+		rasterizeFlatTriangleWithDepth(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::STEALTH:
+		rasterizeStealthTriangle(tri, left, right, top, bottom);
+		break;
+	case RasterTriangle::REFLECTIVE:
+	case RasterTriangle::REFRACTIVE:
+		rasterizeEnvMappedTriangle(tri, left, right, top, bottom);
+		break;
+	}
+}
+
+void SWRenderTarget::setIsEarlyDepthTestOn(bool value)
+{
+	isEarlyDepthTestOn = value;
+	if (!isEarlyDepthTestOn)
+		return;
+
+	if (hiZ.empty()) {
+		// level 0 has one cell per rasterizer block, then halve until 1x1
+		int levelW = (w + EdgeEvaluator::K_BLOCK_SIZE - 1) / EdgeEvaluator::K_BLOCK_SIZE;
+		int levelH = (h + EdgeEvaluator::K_BLOCK_SIZE - 1) / EdgeEvaluator::K_BLOCK_SIZE;
+		while (true) {
+			hiZWidths.push_back(levelW);
+			hiZHeights.push_back(levelH);
+			hiZ.push_back(vector<float>(levelW * levelH, 0.0f));
+			if (levelW == 1 && levelH == 1)
+				break;
+			levelW = (levelW + 1) / 2;
+			levelH = (levelH + 1) / 2;
+		}
+	}
+	// Hi-Z was not maintained while off, start over from zb
+	buildHiZ(0);
+	isHiZValid = true;
+}
+
+void SWRenderTarget::buildHiZ(int fromLevel)
+{
+	if (fromLevel == 0) {
+		for (int cv = 0; cv < hiZHeights[0]; cv++) {
+			for (int cu = 0; cu < hiZWidths[0]; cu++) {
+				int blockU = cu * EdgeEvaluator::K_BLOCK_SIZE;
+				int blockV = cv * EdgeEvaluator::K_BLOCK_SIZE;
+				float farthest = FLT_MAX;
+				for (int v = blockV; v < min(blockV + EdgeEvaluator::K_BLOCK_SIZE, h); v++) {
+					for (int u = blockU; u < min(blockU + EdgeEvaluator::K_BLOCK_SIZE, w); u++) {
+						farthest = min(farthest, zb[(h - 1 - v)*w + u]);
+					}
+				}
+				hiZ[0][cv * hiZWidths[0] + cu] = farthest;
+			}
+		}
+		fromLevel = 1;
+	}
+
+	for (int level = fromLevel; level < (int)hiZ.size(); level++) {
+		int childW = hiZWidths[level - 1];
+		int childH = hiZHeights[level - 1];
+		const vector<float> &child = hiZ[level - 1];
+		for (int cv = 0; cv < hiZHeights[level]; cv++) {
+			for (int cu = 0; cu < hiZWidths[level]; cu++) {
+				float farthest = child[(2 * cv) * childW + 2 * cu];
+				if (2 * cu + 1 < childW)
+					farthest = min(farthest, child[(2 * cv) * childW + 2 * cu + 1]);
+				if (2 * cv + 1 < childH) {
+					farthest = min(farthest, child[(2 * cv + 1) * childW + 2 * cu]);
+					if (2 * cu + 1 < childW)
+						farthest = min(farthest, child[(2 * cv + 1) * childW + 2 * cu + 1]);
+				}
+				hiZ[level][cv * hiZWidths[level] + cu] = farthest;
+			}
+		}
+	}
+}
+
+void SWRenderTarget::updateHiZBlock(int blockU, int blockV)
+{
+	int cu = blockU / EdgeEvaluator::K_BLOCK_SIZE;
+	int cv = blockV / EdgeEvaluator::K_BLOCK_SIZE;
+
+	float farthest = FLT_MAX;
+	for (int v = blockV; v < min(blockV + EdgeEvaluator::K_BLOCK_SIZE, h); v++) {
+		const float *zbRow = &zb[(h - 1 - v)*w];
+		for (int u = blockU; u < min(blockU + EdgeEvaluator::K_BLOCK_SIZE, w); u++) {
+			farthest = min(farthest, zbRow[u]);
+		}
+	}
+	if (hiZ[0][cv * hiZWidths[0] + cu] == farthest)
+		return; // nothing changed for the levels above either
+	hiZ[0][cv * hiZWidths[0] + cu] = farthest;
+
+	// while rasterizing a tile only the cells inside it belong to this thread,
+	// flushTiles() rebuilds the rest when all workers are done
+	int cellSize = EdgeEvaluator::K_BLOCK_SIZE;
+	for (int level = 1; level < (int)hiZ.size(); level++) {
+		cellSize *= 2;
+		if (currentTileOwner == this && cellSize > K_TILE_SIZE)
+			break;
+		int childW = hiZWidths[level - 1];
+		int childH = hiZHeights[level - 1];
+		int childU = (cu / 2) * 2;
+		int childV = (cv / 2) * 2;
+		const vector<float> &child = hiZ[level - 1];
+		farthest = child[childV * childW + childU];
+		if (childU + 1 < childW)
+			farthest = min(farthest, child[childV * childW + childU + 1]);
+		if (childV + 1 < childH) {
+			farthest = min(farthest, child[(childV + 1) * childW + childU]);
+			if (childU + 1 < childW)
+				farthest = min(farthest, child[(childV + 1) * childW + childU + 1]);
+		}
+		cu /= 2;
+		cv /= 2;
+		hiZ[level][cv * hiZWidths[level] + cu] = farthest;
+	}
+}
+
+bool SWRenderTarget::isBlockOccluded(int blockU, int blockV, float maxDepth) const
+{
+	if (!isHiZValid)
+		return false;
+	int cu = blockU / EdgeEvaluator::K_BLOCK_SIZE;
+	int cv = blockV / EdgeEvaluator::K_BLOCK_SIZE;
+	// setIfOneOverWCloser does not draw over equal 1/w either
+	return maxDepth <= hiZ[0][cv * hiZWidths[0] + cu];
+}
+
+bool SWRenderTarget::isTriangleOccluded(const TriangleSetup & setup, int left, int right, int top, int bottom) const
+{
+	if (!isHiZValid)
+		return false;
+
+	// closest 1/w over the pixel centers of the rectangle, evaluated exactly
+	// like the rasterizers do per pixel. The vertex 1/w values are no good
+	// here, the plane can round to a slightly larger value at pixel centers
+	float maxDepth = EdgeEvaluator(setup.eeqs, setup.depthABC).getMaxDepth(left, top, right, bottom);
+
+	// go up the pyramid until the pixel rectangle spans at most 2x2 cells
+	int level = 0;
+	int cellSize = EdgeEvaluator::K_BLOCK_SIZE;
+	while (level + 1 < (int)hiZ.size() &&
+		((right / cellSize - left / cellSize > 1) ||
+		(bottom / cellSize - top / cellSize > 1))) {
+		level++;
+		cellSize *= 2;
+	}
+	for (int cv = top / cellSize; cv <= bottom / cellSize; cv++) {
+		for (int cu = left / cellSize; cu <= right / cellSize; cu++) {
+			if (maxDepth > hiZ[level][cv * hiZWidths[level] + cu])
+				return false; // might be visible in this cell
+		}
+	}
+	return true;
+}
+
+// same texture, light, camera and shading parameters, lets registerMaterial
+// reuse one material table entry for all the triangles of a draw
+bool SWRenderTarget::ShadingMaterial::operator==(const ShadingMaterial & other) const
+{
+	return type == other.type && hasColors == other.hasColors &&
+		texture == other.texture && cam == other.cam &&
+		light == other.light && isShadowMapOn == other.isShadowMapOn &&
+		isLightProjOn == other.isLightProjOn && lightProj == other.lightProj &&
+		cubeMap == other.cubeMap && nl == other.nl && nt == other.nt;
+}
+
+V3 SWRenderTarget::shadePixel(const ShadingMaterial & material, const V3 & pixC,
+	const V3 & color, V3 normal, float s, float t, float lod, float shadowFactor) const
+{
+	const float fresnelPowerExpTerm = 11.0f;
+	V3 shadedColor = color;
+	unsigned int texelColor;
+
+	// get 3d point corresponding to this pixel
+	V3 pixel3dPoint = material.cam->unproject(pixC);
+
+	if (material.type == ShadingMaterial::LIT) {
+		if (material.texture != nullptr) {
+			// sample texture using lerped result of s,t raster parameters (in model space)
+			texelColor = material.texture->sampleTexTrilinearTile(s, t, lod);
+			V3 texelColorVec(texelColor);
+			texelColorVec.modulateBy(shadedColor); // however modulate texture color against pixel lit value
+			shadedColor = texelColorVec;
+		}
+
+		// do shadow mapping
+		if (material.isShadowMapOn) {
+			if (shadowFactor < 0.0f)
+				shadowFactor = material.light->getShadowFactor(pixel3dPoint);
+			if (shadowFactor > 0.0f) {
+				V3 shadowColor;
+				if (material.texture == nullptr) // this works without texture
+					shadowColor = material.light->getMatColor() * material.light->getAmbientK();
+				else // this works with texture
+					shadowColor = shadedColor * material.light->getAmbientK();
+				// only partly in shadow with filtering (PCF)
+				shadedColor = (shadowFactor >= 1.0f) ? shadowColor :
+					shadedColor + (shadowColor - shadedColor) * shadowFactor;
+			}
+		}
+
+		// do projective texture mapping
+		if (material.isLightProjOn && material.lightProj->getProjectedColor(pixel3dPoint, texelColor)) {
+
+			V3 lightProjColor;
+			lightProjColor.setFromColor(texelColor);
+			unsigned char alpha = ((unsigned char*)(&texelColor))[3];
+			float alphaModulation = (float)(alpha) / 255.0f;
+			// make use of projective texture with alpha mask included (very useful for text)
+			if (alpha > 0)
+			{
+				shadedColor += (lightProjColor * alphaModulation);
+			}
+		}
+		return shadedColor;
+	}
+
+	// need to renormalize normal at this point
+	normal.normalize();
+
+	// calculate the reflected ray R that is incident with the surface normal	
+	// proj a onto v = ((a * v) * v) / v.length
+	// if v is normalized -> proj a onto v = (a * v) v
+	// apply this formula to obtain vector B in figure 10.2 of MirrorReflectionVector.pdf
+	// the rest of the derivation is straightforward 
+	// R = E - 2 (E * N) N where E is the incident light ray coming from the camera
+
+	// use 3d pixel to find direction of incident ray of light from eye to pixel
+	V3 E = pixel3dPoint - material.cam->getEyePoint();
+	E.normalize();
+	// Use incident ray direction and normal to find reflected ray direction
+	V3 R = E - (normal * (2 * (E * normal)));
+	R.normalize();
+	// use ray's direction to look up reflective color in environament map
+	V3 envColor = material.cubeMap->getColor(R);
+
+	if (material.type == ShadingMaterial::REFRACTIVE) {
+		V3 refractiveColor;
+		float nl = material.nl, nt = material.nt;
+		// calculate the transmission ray T that is transmitted through the material 
+		// (refracted). Formula employed here was derived in chapter 13.1 of Interactive
+		// Fundamentals of Computer Graphics by Peter Shirley, et. al. which in turn is derived 
+		// from Snell's Law:
+		// T = (nl/nt) * ( E - N (E * N) ) - nl * sqrt(1 - (pow(nl/nt,2) * (1 - pow(E*N, 2) )
+		// Note: E and n are assumed to be unit length vectors
+		float tempDotProduct = E * normal;
+		// If number under sqrt is negative then all the energy is reflected and none refracted
+		float tempBeforeSqrResult = 1 - (((nl * nl) * (1 - (tempDotProduct * tempDotProduct))) / (nt * nt));
+		if (tempBeforeSqrResult >= 0) {
+			V3 T = ((E - (normal * tempDotProduct)) * (nl / nt)) -
+				(normal * sqrt(tempBeforeSqrResult));
+			T.normalize();
+			// use ray's direction to look up refractive color in environament map
+			refractiveColor = material.cubeMap->getColor(T);
+		}
+		else { // all energy was reflected and none refracted
+			refractiveColor = envColor;
+		}
+
+		// approximate Fresnel equation to approximate how much is reflected and how
+		// much is refracted due to wavelenth and polarization of the light: 
+		V3 l = material.cam->getEyePoint() - pixel3dPoint;
+		l.normalize();
+		float fresnelCoeff = max(0.0f, pow(l*normal, fresnelPowerExpTerm));
+		envColor = (envColor * fresnelCoeff) + (refractiveColor * (1 - fresnelCoeff));
+	}
+
+	if (!material.hasColors)
+		shadedColor = envColor;
+	else
+		shadedColor.modulateBy(envColor);
+
+	if (material.texture != nullptr) {
+		// sample texture using lerped result of s,t raster parameters (in model space)
+		texelColor = material.texture->sampleTexBilinearTile(s, t);
+		V3 texelColorVec(texelColor);
+		shadedColor += texelColorVec;
+	}
+	return shadedColor;
+}
+
+void SWRenderTarget::setIsDeferredShadingOn(bool value)
+{
+	if (!value && isDeferredShadingOn)
+		resolveDeferredShading(); // don't lose what was already deferred
+	isDeferredShadingOn = value;
+	if (isDeferredShadingOn && gBuffer.empty()) {
+		GBufferTexel emptyTexel;
+		emptyTexel.s = emptyTexel.t = emptyTexel.lod = 0.0f;
+		emptyTexel.materialId = K_NO_MATERIAL;
+		gBuffer.resize(w * h, emptyTexel);
+	}
+}
+
+int SWRenderTarget::registerMaterial(const ShadingMaterial & material)
+{
+	std::lock_guard<std::mutex> lock(gbMaterialsMutex);
+	// consecutive triangles nearly always come from the same mesh
+	for (int mi = (int)gbMaterials.size() - 1; mi >= 0; mi--) {
+		if (gbMaterials[mi] == material)
+			return mi;
+	}
+	gbMaterials.push_back(material);
+	return (int)gbMaterials.size() - 1;
+}
+
+void SWRenderTarget::clearGBuffer(void)
+{
+	if (gbMaterials.empty())
+		return; // no pixel can reference a material
+	for (size_t i = 0; i < gBuffer.size(); i++)
+		gBuffer[i].materialId = K_NO_MATERIAL;
+	gbMaterials.clear();
+}
+
+void SWRenderTarget::resolveDeferredShading(void)
+{
+	if (gbMaterials.empty())
+		return; // nothing got deferred since last time
+
+	// pixels shade independently, hand out bands of rows to the workers
+	int bandsN = (h + K_TILE_SIZE - 1) / K_TILE_SIZE;
+	WorkerPool::getShared().parallelFor(bandsN, [this](int band) {
+		for (int v = band * K_TILE_SIZE; v < min((band + 1) * K_TILE_SIZE, h); v++) {
+			for (int u = 0; u < w; u++) {
+				GBufferTexel &texel = gBuffer[(h - 1 - v)*w + u];
+				if (texel.materialId == K_NO_MATERIAL)
+					continue;
+				V3 pixC(.5f + (float)u, .5f + (float)v, zb[(h - 1 - v)*w + u]);
+				V3 shadedColor = shadePixel(gbMaterials[texel.materialId], pixC,
+					texel.color, texel.normal, texel.s, texel.t, texel.lod);
+				set(u, v, shadedColor.getColor());
+				texel.materialId = K_NO_MATERIAL;
+			}
+		}
+	});
+	gbMaterials.clear();
+}
+
+void SWRenderTarget::computeEdgeEquations(const V3 * const pvs, V3 * eeqs)
+{
+	// eeqs[0] = (A, B, C), where Au + Bv + C
+	for (int ei = 0; ei < 3; ei++) {
+		int e1 = (ei + 1) % 3;
+		eeqs[ei][0] = pvs[e1][1] - pvs[ei][1];
+		eeqs[ei][1] = pvs[ei][0] - pvs[e1][0];
+		eeqs[ei][2] = -pvs[ei][1] * eeqs[ei][1] - pvs[ei][0] * eeqs[ei][0];
+		int e2 = (e1 + 1) % 3;
+		// plug third vertex into edge equation to establish
+		// correct sidedness
+		V3 pv3(pvs[e2][0], pvs[e2][1], 1.0f); // (u2, v2, 1)
+		if (eeqs[ei] * pv3 < 0.0f)
+			eeqs[ei] = eeqs[ei] * -1.0f;
+	}
+}
+
+void SWRenderTarget::computeTriangleSetup(const V3 * const pvs, TriangleSetup & setup)
+{
+	// set edge equations
+	computeEdgeEquations(pvs, setup.eeqs);
+
+	// set screen space interpolation
+	M33 &baryMatrixInverse = setup.baryMatrixInverse;
+	baryMatrixInverse[0] = pvs[0];
+	baryMatrixInverse[1] = pvs[1];
+	baryMatrixInverse[2] = pvs[2];
+	baryMatrixInverse.setColumn(V3(1.0f, 1.0f, 1.0f), 2);
+	baryMatrixInverse.setInverted();
+	// linear expression for screen space interpolation of 1/w
+	setup.depthABC = baryMatrixInverse*V3(pvs[0][2], pvs[1][2], pvs[2][2]);
+}
+
+// draw circle
+void SWRenderTarget::draw2DCircle(float cuf, float cvf, float radius,
+	unsigned int color)
+{
+	// compute screen axes-aligned bounding box for triangle 
+	// clipping against SWFramebuffer
+	AABB aabb(V3(cuf - radius + 0.5f, cvf + radius - 0.5f));
+	aabb.AddPoint(V3(cuf + radius - 0.5f, cvf - radius + 0.5f));
+
+	if (!aabb.clipWithFrame(0.0f, 0.0f, (float)w, (float)h))
+		return;
+
+	int left, right, top, bottom;
+	aabb.setPixelRectangle(left, right, top, bottom);
+
+	float radius2 = radius*radius;
+	for (int v = top; v <= bottom; v++) {
+		for (int u = left; u <= right; u++) {
+			float uf = .5f + (float)u;
+			float vf = .5f + (float)v;
+			float d2 = (cvf - vf)*(cvf - vf) + (cuf - uf)*(cuf - uf);
+			if (d2 > radius2)
+				continue;
+			set(u, v, color); // ignores z-buffer
+		}
+	}
+}
+
+// draw 2D circle only where it wins the z-fight
+void SWRenderTarget::draw2DCircleIfCloser(const V3 &p, float radius, const V3 &color)
+{
+	// compute screen axes-aligned bounding box for triangle 
+	// clipping against SWFramebuffer
+	AABB aabb(V3(p.getX() - radius + 0.5f, p.getY() + radius - 0.5f));
+	aabb.AddPoint(V3(p.getX() + radius - 0.5f, p.getY() - radius + 0.5f));
+
+	if (!aabb.clipWithFrame(0.0f, 0.0f, (float)w, (float)h))
+		return;
+
+	int left, right, top, bottom;
+	aabb.setPixelRectangle(left, right, top, bottom);
+
+	float radius2 = radius*radius;
+	for (int v = top; v <= bottom; v++) {
+		for (int u = left; u <= right; u++) {
+			float uf = .5f + (float)u;
+			float vf = .5f + (float)v;
+			float d2 = (p.getY() - vf)*(p.getY() - vf) +
+				(p.getX() - uf)*(p.getX() - uf);
+			if (d2 > radius2)
+				continue;
+			setIfOneOverWCloser(V3(uf, vf, p.getZ()), color);
+		}
+	}
+}
+
+// draw axis aligned rectangle
+void SWRenderTarget::draw2DRectangle(
+	float llu,
+	float llv,
+	float width,
+	float height,
+	unsigned int color)
+{
+	// compute screen axes-aligned bounding box for triangle 
+	// clipping against SWFramebuffer
+	AABB aabb(V3(llu + 0.5f, llv - 0.5f));
+	aabb.AddPoint(V3(llu + width - 0.5f, llv - height + 0.5f));
+
+	if (!aabb.clipWithFrame(0.0f, 0.0f, (float)w, (float)h))
+		return;
+
+	int left, right, top, bottom;
+	aabb.setPixelRectangle(left, right, top, bottom);
+
+	for (int v = top; v <= bottom; v++) {
+		for (int u = left; u <= right; u++) {
+			float uf = .5f + (float)u;
+			float vf = .5f + (float)v;
+			set(u, v, color);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DFlatTriangle(
+	V3 *const pvs,
+	unsigned int color)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::FLAT, pvs, nullptr, tri))
+		return;
+	tri.color = color;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeFlatTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const V3 *eeqs = tri.setup.eeqs;
+	unsigned int color = tri.color;
+
+	int currPixV; // current pixel row considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // unused, there is no depth test
+	EdgeEvaluator edgeEval(eeqs, V3());
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				unsigned int *pixRow = &pix[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, nullptr, 0, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle
+					// set pixels inside of triangle to color, ignores depth test
+					EdgeEvaluator::maskedStoreQuad(pixRow, w, quadPixU, quadMask, color);
+				}
+			}
+		}
+	}
+}
+
+void SWRenderTarget::draw2DFlatTriangleScreenSpace(
+	V3 *const pvs,
+	V3 *const cols,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::SCREEN_SPACE, pvs, setup, tri))
+		return;
+	// linear expressions for screen space interpolation of colors
+	const M33 &baryMatrixInverse = tri.setup.baryMatrixInverse;
+	tri.colorNumABCs[0] = baryMatrixInverse*V3(cols[0][0], cols[1][0], cols[2][0]);
+	tri.colorNumABCs[1] = baryMatrixInverse*V3(cols[0][1], cols[1][1], cols[2][1]);
+	tri.colorNumABCs[2] = baryMatrixInverse*V3(cols[0][2], cols[1][2], cols[2][2]);
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeScreenSpaceTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	M33 colsABC;
+	colsABC[0] = tri.colorNumABCs[0];
+	colsABC[1] = tri.colorNumABCs[1];
+	colsABC[2] = tri.colorNumABCs[2];
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+						interpolatedColor = colsABC*pixC; // color at current pixel interp. l s s
+						setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DFlatTriangleModelSpace(
+	V3 *const pvs,
+	V3 *const cols,
+	M33 Q)
+{
+	// this one stores w rather than 1/w in zb, so Hi-Z no longer applies
+	isHiZValid = false;
+
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::MODEL_SPACE, pvs, nullptr, tri))
+		return;
+
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(cols[0].getX(), cols[1].getX(), cols[2].getX());
+	V3 greenParameters(cols[0].getY(), cols[1].getY(), cols[2].getY());
+	V3 blueParameters(cols[0].getZ(), cols[1].getZ(), cols[2].getZ());
+	// w is linear in model space and not linear in screen space.For 1 / w, it's the other way around.
+	// Hence we want to use w here. Projected z is coming out as 1/w by construction so we want to
+	// invert that z to get back to original w.
+	V3 wParameters(1 / (pvs[0].getZ()), 1 / (pvs[1].getZ()), 1 / (pvs[2].getZ()));
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.wNumABC = V3(
+		Q.getColumn(0) * wParameters,
+		Q.getColumn(1) * wParameters,
+		Q.getColumn(2) * wParameters);
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeModelSpaceTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const V3 *eeqs = tri.setup.eeqs;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &redNumABC = tri.colorNumABCs[0];
+	const V3 &greenNumABC = tri.colorNumABCs[1];
+	const V3 &blueNumABC = tri.colorNumABCs[2];
+	const V3 &depthNumABC = tri.wNumABC;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	EdgeEvaluator edgeEval(eeqs, V3());
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, nullptr, 0, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle
+						// found pixel inside of triangle; set it to right color
+
+						   // find interpolated parameter t by following the model space formula
+						   // for rater parameter linear interpolation 
+						   // t = ((A * u) + (B * v) + C) / ((D * u) + (E * v) + F)
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						float denFactor = quadDen[qi];
+						interpolatedColor[0] = (redNumABC * pixC) / denFactor;
+						interpolatedColor[1] = (greenNumABC * pixC) / denFactor;
+						interpolatedColor[2] = (blueNumABC * pixC) / denFactor;
+						interpolatedDepth = (depthNumABC * pixC) / denFactor;
+						setIfWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SWRenderTarget::draw2DTexturedTriangle(
+	V3 *const pvs,
+	V3 *const cols,
+	const V3 &sCoords,
+	const V3 &tCoords,
+	M33 Q,
+	const Texture &texture,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::TEXTURED, pvs, setup, tri))
+		return;
+
+	// set model space interpolation of s,t. Vertex colors are not
+	// interpolated, the texel replaces them
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	tri.material.texture = &texture;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeTexturedTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &sNumABC = tri.sNumABC, &tNumABC = tri.tNumABC;
+	const Texture &texture = *tri.material.texture;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+	float lod; // texture level of detail, one per quad
+	// s,t of the covered pixels of a quad, packed together so the texture
+	// gets sampled with one span call per quad
+	float spanS[EdgeEvaluator::K_QUAD_W], spanT[EdgeEvaluator::K_QUAD_W];
+	unsigned int spanColors[EdgeEvaluator::K_QUAD_W];
+	int spanN, si;
+	float spanDen = 1.0f; // persp correct denominator of the first covered pixel
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					// s and t are interpolated in model space for the covered pixels
+					spanN = 0;
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						if (spanN == 0)
+							spanDen = quadDen[qi];
+						spanS[spanN] = (sNumABC * pixC) / quadDen[qi];
+						spanT[spanN] = (tNumABC * pixC) / quadDen[qi];
+						spanN++;
+					}
+					// the first covered pixel decides the lod of the whole quad
+					lod = isMipMappingOn ? computePerspCorrectLod(texture, sNumABC, tNumABC,
+						denDEF, spanS[0], spanT[0], spanDen) : 0.0f;
+					// sample texture using lerped result of s,t raster parameters (in model space)
+					texture.sampleTexTrilinearTileSpan(spanS, spanT, lod, spanN, spanColors);
+					for (qi = 0, si = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						// 1/w is interpoalted in screen space
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+						// override interpolated color for now. In the future texel can be modulated by color
+						interpolatedColor.setFromColor(spanColors[si++]);
+
+						setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DSprite(
+	V3 *const pvs,
+	V3 *const cols,
+	const V3 &sCoords,
+	const V3 &tCoords,
+	M33 Q,
+	const Texture &texture,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::SPRITE, pvs, setup, tri))
+		return;
+
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(cols[0].getX(), cols[1].getX(), cols[2].getX());
+	V3 greenParameters(cols[0].getY(), cols[1].getY(), cols[2].getY());
+	V3 blueParameters(cols[0].getZ(), cols[1].getZ(), cols[2].getZ());
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	tri.material.texture = &texture;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeSprite(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &redNumABC = tri.colorNumABCs[0];
+	const V3 &greenNumABC = tri.colorNumABCs[1];
+	const V3 &blueNumABC = tri.colorNumABCs[2];
+	const V3 &sNumABC = tri.sNumABC, &tNumABC = tri.tNumABC;
+	const Texture &texture = *tri.material.texture;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+	float interpolatedS, interpolatedT; // final raster parameter interpolated result
+	unsigned int texelColor;
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						// r,g,b, s, and t are interpolated in model space
+						float denFactor = quadDen[qi];
+						interpolatedColor[0] = (redNumABC * pixC) / denFactor;
+						interpolatedColor[1] = (greenNumABC * pixC) / denFactor;
+						interpolatedColor[2] = (blueNumABC * pixC) / denFactor;
+						interpolatedS = (sNumABC * pixC) / denFactor;
+						interpolatedT = (tNumABC * pixC) / denFactor;
+						// 1/w is interpoalted in screen space
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+
+															 // sample texture using lerped result of s,t raster parameters (in model space)
+						// only the fixed point bilinear filter keeps alpha
+						if (texture.getIsFixedPointFilteringOn())
+							texelColor = texture.sampleTexBilinearClamp(interpolatedS, interpolatedT);
+						else
+							texelColor = texture.sampleTexNearClamp(interpolatedS, interpolatedT);
+
+						// override interpolated color for now. In the future texel can be modulated by color
+						interpolatedColor.setFromColor(texelColor);
+
+						// test sprite support (alpha based) works
+						unsigned char alpha = ((unsigned char*)(&texelColor))[3];
+						if (alpha > 0)
+						{
+							float alphaModulation = (float)(alpha);
+							alphaModulation /= 255.0f;
+							interpolatedColor[0] = interpolatedColor[0] * alphaModulation;
+							interpolatedColor[1] = interpolatedColor[1] * alphaModulation;
+							interpolatedColor[2] = interpolatedColor[2] * alphaModulation;
+							setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+						}
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DLitTriangle(
+	V3 * const vs,
+	V3 * const pvs,
+	V3 * const cols,
+	const V3 * const normals,
+	const Light & light,
+	M33 Q,
+	const V3 & sCoords,
+	const V3 & tCoords,
+	const Texture * const texture,
+	bool isShadowMapOn,
+	const PPC &cam,
+	bool isLightProjOn,
+	const LightProjector *const lightProj,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::LIT, pvs, setup, tri))
+		return;
+
+	// compute lighting colors at 3 vertices
+	V3 litCols[3];
+	for (int vi = 0; vi < 3; vi++) {
+		litCols[vi] = light.computeDiffuseContribution(vs[vi], normals[vi]);
+	}
+
+	if (cols != nullptr) {
+
+		litCols[0].modulateBy(cols[0]);
+		litCols[1].modulateBy(cols[1]);
+		litCols[2].modulateBy(cols[2]);
+	}
+
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(litCols[0].getX(), litCols[1].getX(), litCols[2].getX());
+	V3 greenParameters(litCols[0].getY(), litCols[1].getY(), litCols[2].getY());
+	V3 blueParameters(litCols[0].getZ(), litCols[1].getZ(), litCols[2].getZ());
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	ShadingMaterial &material = tri.material;
+	material.type = ShadingMaterial::LIT;
+	material.hasColors = (cols != nullptr);
+	material.texture = texture;
+	material.cam = &cam;
+	material.light = &light;
+	material.isShadowMapOn = isShadowMapOn;
+	material.isLightProjOn = isLightProjOn;
+	material.lightProj = lightProj;
+	tri.materialId = isDeferredShadingOn ? registerMaterial(material) : K_NO_MATERIAL;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeLitTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &redNumABC = tri.colorNumABCs[0];
+	const V3 &greenNumABC = tri.colorNumABCs[1];
+	const V3 &blueNumABC = tri.colorNumABCs[2];
+	const V3 &sNumABC = tri.sNumABC, &tNumABC = tri.tNumABC;
+	const ShadingMaterial &material = tri.material;
+	int materialId = tri.materialId;
+	const Texture *texture = material.texture;
+	const Light &light = *material.light;
+	const PPC &cam = *material.cam;
+	bool isShadowMapOn = material.isShadowMapOn;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	float quadShadow[EdgeEvaluator::K_QUAD_W]; // shadow factor for every pixel in quad, -1 for unknown
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+	float interpolatedS, interpolatedT; // final raster parameter interpolated result
+	float lod; // texture level of detail
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					// shadow lookups for the whole quad at once
+					if (isShadowMapOn && !isDeferredShadingOn)
+						light.getShadowFactorSpan(cam, .5f + (float)quadPixU, .5f + (float)currPixV,
+							quadDepth, EdgeEvaluator::K_QUAD_W, quadShadow);
+					else
+						quadShadow[0] = quadShadow[1] = quadShadow[2] = quadShadow[3] = -1.0f;
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						// r,g,b, s, and t are interpolated in model space
+						float denFactor = quadDen[qi];
+						interpolatedColor[0] = (redNumABC * pixC) / denFactor;
+						interpolatedColor[1] = (greenNumABC * pixC) / denFactor;
+						interpolatedColor[2] = (blueNumABC * pixC) / denFactor;
+						interpolatedS = (sNumABC * pixC) / denFactor;
+						interpolatedT = (tNumABC * pixC) / denFactor;
+						// 1/w is interpoalted in screen space
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+						lod = (texture != nullptr && isMipMappingOn) ? computePerspCorrectLod(*texture,
+							sNumABC, tNumABC, denDEF, interpolatedS, interpolatedT, denFactor) : 0.0f;
+
+						if (isDeferredShadingOn) {
+							// visibility pass only, shading waits for resolveDeferredShading()
+							setGBufferTexel(currPixU, currPixV, interpolatedDepth, interpolatedColor,
+								V3(0.0f, 0.0f, 0.0f), interpolatedS, interpolatedT, lod, materialId);
+							continue;
+						}
+						interpolatedColor = shadePixel(material, V3(pixC[0], pixC[1], interpolatedDepth),
+							interpolatedColor, V3(0.0f, 0.0f, 0.0f), interpolatedS, interpolatedT, lod,
+							quadShadow[qi]);
+						// set pixel in color SWFramebuffer as well as depth buffer if depth test passes
+						setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DFlatTriangleWithDepth(V3 * const pvs, unsigned int color, const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::FLAT_WITH_DEPTH, pvs, setup, tri))
+		return;
+	tri.color = color;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeFlatTriangleWithDepth(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	unsigned int color = tri.color;
+
+	int currPixV; // current pixel row considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pColor; // final raster parameter interpolated result
+	pColor.setFromColor(color);
+	unsigned int packedColor = pColor.getColor(); // same color setIfOneOverWCloser would write
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				float *zbRow = &zb[(h - 1 - currPixV)*w];
+				unsigned int *pixRow = &pix[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					// mask already holds the depth test so write the closer pixels
+					// of the quad straight into the z buffer and color buffer
+					EdgeEvaluator::maskedStoreQuad(zbRow, w, quadPixU, quadMask, quadDepth);
+					EdgeEvaluator::maskedStoreQuad(pixRow, w, quadPixU, quadMask, packedColor);
+					if (isDeferredShadingOn) {
+						for (int qi = 0; qi < EdgeEvaluator::K_QUAD_W; qi++) {
+							if (quadMask & (1 << qi))
+								gBuffer[(h - 1 - currPixV)*w + quadPixU + qi].materialId = K_NO_MATERIAL;
+						}
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DStealthTriangle(
+	V3 * const vs,
+	V3 * const pvs,
+	V3 * const cols,
+	const V3 * const normals,
+	const Light & light,
+	M33 Q,
+	bool isLightOn,
+	bool isTexturedOn,
+	const V3 & sCoords,
+	const V3 & tCoords,
+	const Texture * const texture,
+	const PPC & cam,
+	const LightProjector & lightProj,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::STEALTH, pvs, setup, tri))
+		return;
+
+	// lighting
+	V3 litCols[3];
+	if (isLightOn) {
+		for (int vi = 0; vi < 3; vi++) {
+			litCols[vi] = light.computeDiffuseContribution(vs[vi], normals[vi]);
+		}
+	}
+	else {
+		litCols[0] = cols[0];
+		litCols[1] = cols[1];
+		litCols[2] = cols[2];
+	}
+
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(litCols[0].getX(), litCols[1].getX(), litCols[2].getX());
+	V3 greenParameters(litCols[0].getY(), litCols[1].getY(), litCols[2].getY());
+	V3 blueParameters(litCols[0].getZ(), litCols[1].getZ(), litCols[2].getZ());
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	tri.isTexturedOn = isTexturedOn;
+	tri.material.texture = texture;
+	tri.material.cam = &cam;
+	tri.material.lightProj = &lightProj;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeStealthTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &redNumABC = tri.colorNumABCs[0];
+	const V3 &greenNumABC = tri.colorNumABCs[1];
+	const V3 &blueNumABC = tri.colorNumABCs[2];
+	const V3 &sNumABC = tri.sNumABC, &tNumABC = tri.tNumABC;
+	bool isTexturedOn = tri.isTexturedOn;
+	const Texture *texture = tri.material.texture;
+	const PPC &cam = *tri.material.cam;
+	const LightProjector &lightProj = *tri.material.lightProj;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+	float interpolatedS, interpolatedT; // final raster parameter interpolated result
+	unsigned int texelColor;
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						// r,g,b, s, and t are interpolated in model space
+						float denFactor = quadDen[qi];
+						interpolatedColor[0] = (redNumABC * pixC) / denFactor;
+						interpolatedColor[1] = (greenNumABC * pixC) / denFactor;
+						interpolatedColor[2] = (blueNumABC * pixC) / denFactor;
+						interpolatedS = (sNumABC * pixC) / denFactor;
+						interpolatedT = (tNumABC * pixC) / denFactor;
+						// 1/w is interpoalted in screen space
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+
+															 // TODO: Combine texture color with lit color instead of overriding each other
+						if (isTexturedOn && texture != nullptr) {
+							// sample texture using lerped result of s,t raster parameters (in model space)
+							texelColor = texture->sampleTexBilinearTile(interpolatedS, interpolatedT);
+							// override interpolated color for now. In the future texel can be modulated by color
+							interpolatedColor.setFromColor(texelColor);
+						}
+
+						// get 3d point corresponding to this pixel
+						V3 pixel3dPoint = cam.unproject(V3(pixC[0], pixC[1], interpolatedDepth));
+
+						// TODO: Find a way to combine the colors: interpolated, texture, lit and projLight color
+						// instead of overriding each other (projLight and lit color no longer override each other)
+						// do projective texture mapping
+						if (lightProj.getProjectedStealthColor(pixel3dPoint, texelColor)) {
+
+							V3 lightProjColor;
+							lightProjColor.setFromColor(texelColor);
+							//interpolatedColor += (lightProjColor); // glass material effect (with refraction)
+							interpolatedColor = (lightProjColor); // 100% stealth predator like
+						}
+						// set pixel in color SWFramebuffer as well as depth buffer if depth test passes
+						setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DReflectiveTriangle(
+	CubeMap & cubeMap,
+	const PPC &cam,
+	V3 * const vs,
+	V3 * const pvs,
+	V3 * const cols,
+	const V3 * const normals,
+	M33 Q,
+	const V3 & sCoords,
+	const V3 & tCoords,
+	const Texture * const texture,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::REFLECTIVE, pvs, setup, tri))
+		return;
+
+	V3 colors[3];
+	if (cols == nullptr) {
+		colors[0] = V3(0.7f, 0.0f, 0.0f);
+		colors[1] = V3(0.7f, 0.0f, 0.0f);
+		colors[2] = V3(0.7f, 0.0f, 0.0f);
+	}
+	else {
+		colors[0] = cols[0];
+		colors[1] = cols[1];
+		colors[2] = cols[2];
+	}
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(colors[0].getX(), colors[1].getX(), colors[2].getX());
+	V3 greenParameters(colors[0].getY(), colors[1].getY(), colors[2].getY());
+	V3 blueParameters(colors[0].getZ(), colors[1].getZ(), colors[2].getZ());
+	V3 normalXParameters(normals[0].getX(), normals[1].getX(), normals[2].getX());
+	V3 normalYParameters(normals[0].getY(), normals[1].getY(), normals[2].getY());
+	V3 normalZarameters(normals[0].getZ(), normals[1].getZ(), normals[2].getZ());
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.normalNumABCs[0] = V3(
+		Q.getColumn(0) * normalXParameters,
+		Q.getColumn(1) * normalXParameters,
+		Q.getColumn(2) * normalXParameters);
+	tri.normalNumABCs[1] = V3(
+		Q.getColumn(0) * normalYParameters,
+		Q.getColumn(1) * normalYParameters,
+		Q.getColumn(2) * normalYParameters);
+	tri.normalNumABCs[2] = V3(
+		Q.getColumn(0) * normalZarameters,
+		Q.getColumn(1) * normalZarameters,
+		Q.getColumn(2) * normalZarameters);
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	ShadingMaterial &material = tri.material;
+	material.type = ShadingMaterial::REFLECTIVE;
+	material.hasColors = (cols != nullptr);
+	material.texture = texture;
+	material.cam = &cam;
+	material.cubeMap = &cubeMap;
+	tri.materialId = isDeferredShadingOn ? registerMaterial(material) : K_NO_MATERIAL;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::rasterizeEnvMappedTriangle(const RasterTriangle & tri, int left, int right, int top, int bottom)
+{
+	const TriangleSetup *setup = &tri.setup;
+	const V3 &denDEF = tri.denDEF;
+	const V3 &redNumABC = tri.colorNumABCs[0];
+	const V3 &greenNumABC = tri.colorNumABCs[1];
+	const V3 &blueNumABC = tri.colorNumABCs[2];
+	const V3 &normalXNumABC = tri.normalNumABCs[0];
+	const V3 &normalYNumABC = tri.normalNumABCs[1];
+	const V3 &normalZNumABC = tri.normalNumABCs[2];
+	const V3 &sNumABC = tri.sNumABC, &tNumABC = tri.tNumABC;
+	const ShadingMaterial &material = tri.material;
+	int materialId = tri.materialId;
+
+	int currPixU, currPixV; // current pixel considered
+	int blockU, blockV; // current block of pixels considered (Hi-Z cell corner)
+	int blockLeft, blockTop, blockRight, blockBottom; // part of current block inside AABB
+	EdgeEvaluator::BlockCoverage blockCoverage;
+	bool isBlockCovered;
+	int quadPixU, quadMask, qi; // current quad of pixels considered
+	float quadDepth[EdgeEvaluator::K_QUAD_W]; // 1/w for every pixel in quad
+	float quadDen[EdgeEvaluator::K_QUAD_W]; // persp correct denominator for every pixel in quad
+	EdgeEvaluator edgeEval(setup->eeqs, setup->depthABC);
+	V3 pixC; // current pixel center
+	V3 interpolatedColor; // final raster parameter interpolated result
+	V3 interpolatedNormal; // final raster parameter interpolated result
+	float interpolatedDepth; // final raster parameter interpolated result
+	float interpolatedS, interpolatedT; // final raster parameter interpolated result
+
+	// rasterize triangle in blocks of pixels (aligned with the Hi-Z cells),
+	// one quad of pixels at a time
+	for (blockV = top - top % EdgeEvaluator::K_BLOCK_SIZE; blockV <= bottom; blockV += EdgeEvaluator::K_BLOCK_SIZE) {
+		for (blockU = left - left % EdgeEvaluator::K_BLOCK_SIZE; blockU <= right; blockU += EdgeEvaluator::K_BLOCK_SIZE) {
+
+			blockLeft = max(blockU, left);
+			blockTop = max(blockV, top);
+			blockRight = min(blockU + EdgeEvaluator::K_BLOCK_SIZE - 1, right);
+			blockBottom = min(blockV + EdgeEvaluator::K_BLOCK_SIZE - 1, bottom);
+			blockCoverage = edgeEval.classifyBlock(blockLeft, blockTop, blockRight, blockBottom);
+			if (blockCoverage == EdgeEvaluator::BLOCK_OUTSIDE)
+				continue; // whole block is outside triangle
+			if (isEarlyDepthTestOn && isBlockOccluded(blockU, blockV,
+				edgeEval.getMaxDepth(blockLeft, blockTop, blockRight, blockBottom)))
+				continue; // whole block is behind what is already in zb
+			isBlockCovered = (blockCoverage == EdgeEvaluator::BLOCK_COVERED);
+			for (currPixV = blockTop; currPixV <= blockBottom; currPixV++) {
+				edgeEval.setRow(currPixV);
+				const float *zbRow = &zb[(h - 1 - currPixV)*w];
+				for (quadPixU = blockU; quadPixU <= blockRight; quadPixU += EdgeEvaluator::K_QUAD_W) {
+
+					quadMask = edgeEval.computeQuadMask(quadPixU, blockLeft, blockRight, zbRow, w, quadDepth, isBlockCovered);
+					if (quadMask == 0)
+						continue; // whole quad is outside triangle or hidden
+					EdgeEvaluator::evalPlaneQuad(denDEF, quadPixU, currPixV, quadDen);
+					for (qi = 0, currPixU = quadPixU; qi < EdgeEvaluator::K_QUAD_W; qi++, currPixU++) {
+
+						if (!(quadMask & (1 << qi)))
+							continue; // outside triangle or hidden
+						// found pixel inside of triangle; set it to right color
+
+						pixC = V3(.5f + (float)currPixU, .5f + (float)currPixV, 1.0f);
+						// r,g,b, s, and t are interpolated in model space
+						float denFactor = quadDen[qi];
+						interpolatedColor[0] = (redNumABC * pixC) / denFactor;
+						interpolatedColor[1] = (greenNumABC * pixC) / denFactor;
+						interpolatedColor[2] = (blueNumABC * pixC) / denFactor;
+						interpolatedNormal[0] = (normalXNumABC * pixC) / denFactor;
+						interpolatedNormal[1] = (normalYNumABC * pixC) / denFactor;
+						interpolatedNormal[2] = (normalZNumABC * pixC) / denFactor;
+						interpolatedS = (sNumABC * pixC) / denFactor;
+						interpolatedT = (tNumABC * pixC) / denFactor;
+						// 1/w is interpoalted in screen space
+						interpolatedDepth = quadDepth[qi]; // 1/w at current pixel interpolated lin. in s s
+
+						if (isDeferredShadingOn) {
+							// visibility pass only, shading waits for resolveDeferredShading()
+							setGBufferTexel(currPixU, currPixV, interpolatedDepth, interpolatedColor,
+								interpolatedNormal, interpolatedS, interpolatedT, 0.0f, materialId);
+							continue;
+						}
+						// normal gets renormalized in there
+						interpolatedColor = shadePixel(material, V3(pixC[0], pixC[1], interpolatedDepth),
+							interpolatedColor, interpolatedNormal, interpolatedS, interpolatedT, 0.0f);
+
+						// set pixel in color SWFramebuffer as well as depth buffer if depth test passes
+						setIfOneOverWCloser(V3(pixC[0], pixC[1], interpolatedDepth), interpolatedColor);
+					}
+				}
+			}
+			if (isEarlyDepthTestOn)
+				updateHiZBlock(blockU, blockV);
+		}
+	}
+}
+
+void SWRenderTarget::draw2DRefractiveTriangle(
+	float nl, float nt,
+	CubeMap & cubeMap,
+	const PPC & cam,
+	V3 * const vs,
+	V3 * const pvs,
+	V3 * const cols,
+	const V3 * const normals,
+	M33 Q,
+	const V3 & sCoords,
+	const V3 & tCoords,
+	const Texture * const texture,
+	const TriangleSetup * setup)
+{
+	RasterTriangle tri;
+	if (!setUpRasterTriangle(RasterTriangle::REFRACTIVE, pvs, setup, tri))
+		return;
+
+	V3 colors[3];
+	if (cols == nullptr) {
+		colors[0] = V3(0.7f, 0.0f, 0.0f);
+		colors[1] = V3(0.7f, 0.0f, 0.0f);
+		colors[2] = V3(0.7f, 0.0f, 0.0f);
+	}
+	else {
+		colors[0] = cols[0];
+		colors[1] = cols[1];
+		colors[2] = cols[2];
+	}
+	// set model space interpolation
+	// build rasterization parameters to be lerped in screen space
+	V3 redParameters(colors[0].getX(), colors[1].getX(), colors[2].getX());
+	V3 greenParameters(colors[0].getY(), colors[1].getY(), colors[2].getY());
+	V3 blueParameters(colors[0].getZ(), colors[1].getZ(), colors[2].getZ());
+	V3 normalXParameters(normals[0].getX(), normals[1].getX(), normals[2].getX());
+	V3 normalYParameters(normals[0].getY(), normals[1].getY(), normals[2].getY());
+	V3 normalZarameters(normals[0].getZ(), normals[1].getZ(), normals[2].getZ());
+	// refer to slide 7 of RastParInterp.pdf for the math 
+	// derivation of the persp correct coefficients
+	tri.denDEF = Q[0] + Q[1] + Q[2];
+	tri.colorNumABCs[0] = V3(
+		Q.getColumn(0) * redParameters,
+		Q.getColumn(1) * redParameters,
+		Q.getColumn(2) * redParameters);
+	tri.colorNumABCs[1] = V3(
+		Q.getColumn(0) * greenParameters,
+		Q.getColumn(1) * greenParameters,
+		Q.getColumn(2) * greenParameters);
+	tri.colorNumABCs[2] = V3(
+		Q.getColumn(0) * blueParameters,
+		Q.getColumn(1) * blueParameters,
+		Q.getColumn(2) * blueParameters);
+	tri.normalNumABCs[0] = V3(
+		Q.getColumn(0) * normalXParameters,
+		Q.getColumn(1) * normalXParameters,
+		Q.getColumn(2) * normalXParameters);
+	tri.normalNumABCs[1] = V3(
+		Q.getColumn(0) * normalYParameters,
+		Q.getColumn(1) * normalYParameters,
+		Q.getColumn(2) * normalYParameters);
+	tri.normalNumABCs[2] = V3(
+		Q.getColumn(0) * normalZarameters,
+		Q.getColumn(1) * normalZarameters,
+		Q.getColumn(2) * normalZarameters);
+	tri.sNumABC = V3(
+		Q.getColumn(0) * sCoords,
+		Q.getColumn(1) * sCoords,
+		Q.getColumn(2) * sCoords);
+	tri.tNumABC = V3(
+		Q.getColumn(0) * tCoords,
+		Q.getColumn(1) * tCoords,
+		Q.getColumn(2) * tCoords);
+
+	ShadingMaterial &material = tri.material;
+	material.type = ShadingMaterial::REFRACTIVE;
+	material.hasColors = (cols != nullptr);
+	material.texture = texture;
+	material.cam = &cam;
+	material.cubeMap = &cubeMap;
+	material.nl = nl;
+	material.nt = nt;
+	tri.materialId = isDeferredShadingOn ? registerMaterial(material) : K_NO_MATERIAL;
+	submitTriangle(tri);
+}
+
+void SWRenderTarget::draw2DSegment(const V3 &v0, const V3 &c0, const V3 &v1, const V3 &c1) {
+
+	int stepsN;
+	float duf = fabsf(v0.getX() - v1.getX());
+	float dvf = fabsf(v0.getY() - v1.getY());
+	if (duf > dvf) {
+		// 1 because we want one pixel no matter what
+		stepsN = 2 + (int)duf;
+	}
+	else {
+		// 1 because we want one pixel no matter what
+		stepsN = 2 + (int)dvf;
+	}
+
+	// lerp point along segment as well as its color
+	for (int i = 0; i < stepsN; i++) {
+		float frac = (float)i / (float)(stepsN - 1);
+		V3 p = v0 + (v1 - v0)*frac;
+		V3 c = c0 + (c1 - c0)*frac;
+
+		setIfOneOverWCloser(p, c);
+		//setSafe((int)p[0], (int)p[1], c.getColor()); // ignores z-buffer
+	}
+}
+
+void SWRenderTarget::drawEnvironmentMap(CubeMap & cubeMap, const PPC & cam)
+{
+	V3 a = cam.getLowerCaseA(), b = cam.getLowerCaseB(), c = cam.getLowerCaseC();
+	bool isCacheValid = envMapCache.size() == (size_t)(w * h) &&
+		envMapCacheStamp == cubeMap.getContentsStamp() &&
+		envMapCacheA == a && envMapCacheB == b && envMapCacheC == c;
+
+	if (!isCacheValid) {
+		envMapCache.resize(w * h);
+		// the ray from the eye through pixel (u, v) is a*u + b*v + c, no need
+		// to unproject: step it by a along a row. Rows are independent so
+		// bands of them go to the workers. The cube map lookup doesn't care
+		// about the ray's length so it is not normalized
+		int bandsN = (h + K_TILE_SIZE - 1) / K_TILE_SIZE;
+		WorkerPool::getShared().parallelFor(bandsN, [&](int band) {
+			for (int v = band * K_TILE_SIZE; v < min((band + 1) * K_TILE_SIZE, h); v++) {
+				V3 dir = c + a * 0.5f + b * (.5f + (float)v);
+				unsigned int *row = &envMapCache[(h - 1 - v)*w];
+				for (int u = 0; u < w; u++) {
+					row[u] = cubeMap.getColor(dir).getColor();
+					dir += a;
+				}
+			}
+		});
+		envMapCacheStamp = cubeMap.getContentsStamp();
+		envMapCacheA = a;
+		envMapCacheB = b;
+		envMapCacheC = c;
+	}
+	memcpy(pix, envMapCache.data(), sizeof(unsigned int) * w * h);
+}
+
+void SWRenderTarget::saveAsPng(string fname) const {
+
+	saveAsPngFile("pngs\\" + fname);
+}
+
+bool SWRenderTarget::saveAsPngFile(const string &path) const {
+
+	vector<unsigned char> image;
+	image.reserve(w * h * 4);
+
+	unsigned char red, green, blue, alpha;
+	unsigned int color;
+
+	// copy SWFramebuffer into a more 
+	// friendly format for png library
+	// Also, there is the need to flip
+	// the SWFramebuffer upside down in order 
+	// to get the correct image
+	for (int i = (h - 1); i >= 0; i--) {
+		for (int j = 0; j < w; j++) {
+
+			color = pix[(i*w) + j];
+			red = ((unsigned char*)(&color))[0];
+			green = ((unsigned char*)(&color))[1];
+			blue = ((unsigned char*)(&color))[2];
+			alpha = ((unsigned char*)(&color))[3];
+			image.push_back(red);
+			image.push_back(green);
+			image.push_back(blue);
+			image.push_back(alpha);
+		}
+	}
+
+	// encode the image as a png
+	unsigned error = lodepng::encode(path.c_str(), image, w, h);
+
+	// if there's an error, display it
+	if (error) std::cout << "encoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+
+	return error == 0;
+}
+
+void SWRenderTarget::copyPixels(const SWRenderTarget & other)
+{
+	if (other.w != w || other.h != h) {
+		cerr << "ERROR: copyPixels() needs render targets of the same size" << endl;
+		return;
+	}
+	std::copy(other.pix, other.pix + w * h, pix);
+}
+
+void SWRenderTarget::loadFromPng(string fname) {
+
+	vector<unsigned char> image; //the raw pixels
+	unsigned int width, height;
+
+	//decode
+	unsigned int error = lodepng::decode(image, width, height, fname.c_str());
+
+	//if there's an error, display it
+	if (error) std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+
+	//the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA
+
+	// Only load if it fits in the SWFramebuffer
+	if (width <= (unsigned int)w && height <= (unsigned int)h) {
+		unsigned char red, green, blue, alpha;
+		unsigned int color;
+
+		// copy image into SWFramebuffer 
+		for (unsigned int i = 0, ii = 0; i < height; i++, ii += 4) {
+			for (unsigned int j = 0, jj = 0; j < width; j++, jj += 4) {
+
+				red = image[ii*width + jj + 0];
+				green = image[ii*width + jj + 1];
+				blue = image[ii*width + jj + 2];
+				alpha = image[ii*width + jj + 3];
+
+				((unsigned char*)(&color))[0] = red;
+				((unsigned char*)(&color))[1] = green;
+				((unsigned char*)(&color))[2] = blue;
+				((unsigned char*)(&color))[3] = alpha;
+
+				set(j, i, color);
+			}
+		}
+	}
+	else {
+		std::cout << "decoder error : Image is larger than the SWFramebuffer, please rescale.." << std::endl;
+	}
+
+}
+
+void SWRenderTarget::loadFromTexture(const Texture & texObj)
+{
+	unsigned int width, height;
+	vector<unsigned char> image; //the raw pixels from texture
+
+	image = texObj.getTexels();
+	width = texObj.getTexWidth();
+	height = texObj.getTexHeight();
+
+	//the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw it, ...
+
+	// Only load if it fits in the SWFramebuffer
+	if (width <= (unsigned int)w && height <= (unsigned int)h) {
+		unsigned char red, green, blue, alpha;
+		unsigned int color;
+
+		// copy image into SWFramebuffer 
+		for (unsigned int i = 0, ii = 0; i < height; i++, ii += 4) {
+			for (unsigned int j = 0, jj = 0; j < width; j++, jj += 4) {
+
+				red = image[ii*width + jj + 0];
+				green = image[ii*width + jj + 1];
+				blue = image[ii*width + jj + 2];
+				alpha = image[ii*width + jj + 3];
+
+				((unsigned char*)(&color))[0] = red;
+				((unsigned char*)(&color))[1] = green;
+				((unsigned char*)(&color))[2] = blue;
+				((unsigned char*)(&color))[3] = alpha;
+
+				set(j, i, color);
+			}
+		}
+	}
+	else {
+		std::cout << "decoder error : texture image is larger than the SWFramebuffer, please rescale.." << std::endl;
+	}
+}
@@ -0,0 +1,374 @@
+#pragma once
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <atomic>
+#include <mutex>
+#include "v3.h"
+#include "m33.h"
+#include "texture.h"
+#include "light.h"
+#include "lightprojector.h"
+
+class CubeMap; // need forward declaration here
+class AABB;
+
+// Window independent SW render target. Owns the color and depth buffers and
+// does all the rasterization, so it can be used without a display (shadow
+// maps, headless rendering). SWFrameBuffer adds the window on top of it.
+class SWRenderTarget
+{
+protected:
+	int w, h; // image resolution
+	unsigned int *pix; // SW color buffer
+	float *zb; // zbuffer for visibility
+private:
+
+	// hierarchical z buffer (Hi-Z) for the early depth test. Level 0 keeps
+	// the farthest (smallest) 1/w of every rasterizer block of zb, each level
+	// above the farthest of 2x2 cells of the level below. Stored values may
+	// lag behind zb but only ever on the far side, so they stay conservative.
+	// Only maintained while the early depth test is on.
+	bool isEarlyDepthTestOn;
+	std::atomic<bool> isHiZValid; // false once zb holds w instead of 1/w
+	vector<vector<float>> hiZ;
+	vector<int> hiZWidths, hiZHeights; // cells across and down per level
+	// rebuilds levels fromLevel and above (level 0 is rebuilt from zb)
+	void buildHiZ(int fromLevel);
+	// refreshes level 0 cell of block at pixel (blockU, blockV) from zb and
+	// propagates it upwards as far as the calling thread owns the cells
+	void updateHiZBlock(int blockU, int blockV);
+	// true if a surface whose closest 1/w is maxDepth can't show up anywhere
+	// in the block at pixel (blockU, blockV)
+	bool isBlockOccluded(int blockU, int blockV, float maxDepth) const;
+
+	// everything draw2DLit/Reflective/RefractiveTriangle need to shade a
+	// pixel besides its interpolated raster parameters. Built once per triangle
+	struct ShadingMaterial {
+		enum ShadingType { LIT, REFLECTIVE, REFRACTIVE };
+		ShadingType type;
+		bool hasColors; // false if triangle came without vertex colors
+		const Texture *texture;
+		const PPC *cam;
+		// lit only
+		const Light *light;
+		bool isShadowMapOn;
+		bool isLightProjOn;
+		const LightProjector *lightProj;
+		// reflective and refractive only
+		CubeMap *cubeMap;
+		float nl, nt; // refractive indices (refractive only)
+
+		bool operator==(const ShadingMaterial &other) const;
+	};
+	// shades one pixel; pixC holds pixel center and 1/w, color is the lerped
+	// vertex color (already lit for LIT), normal need not be unit length
+	// lod is the texture mip level to sample at (see Texture::computeLod).
+	// shadowFactor is how much of the pixel is in shadow if the caller
+	// already knows (see Light::getShadowFactorSpan), negative to look it up
+	V3 shadePixel(const ShadingMaterial &material, const V3 &pixC,
+		const V3 &color, V3 normal, float s, float t, float lod,
+		float shadowFactor = -1.0f) const;
+
+	// deferred shading support. When on, the lit, reflective and refractive
+	// rasterizers only resolve visibility: they write 1/w to zb and their
+	// interpolated raster parameters plus a material index to the G-buffer.
+	// resolveDeferredShading() then shades every visible pixel exactly once.
+	struct GBufferTexel {
+		V3 color;
+		V3 normal;
+		float s, t;
+		float lod; // texture level of detail
+		int materialId; // index into gbMaterials, K_NO_MATERIAL if not deferred
+	};
+	static const int K_NO_MATERIAL = -1;
+	bool isDeferredShadingOn;
+	vector<GBufferTexel> gBuffer; // same layout as zb
+	vector<ShadingMaterial> gbMaterials; // materials of current frame
+	std::mutex gbMaterialsMutex; // tile workers register materials concurrently
+	// returns index of material in gbMaterials, adding it if needed
+	int registerMaterial(const ShadingMaterial &material);
+	// forgets all pending deferred pixels and their materials
+	void clearGBuffer(void);
+	// visibility pass write of one pixel that already passed the depth test
+	void setGBufferTexel(int u, int v, float oneOverW, const V3 &color,
+		const V3 &normal, float s, float t, float lod, int materialId);
+
+	// mip mapping support. When on, textured and lit rasterizers pick a
+	// texture level of detail per pixel from the screen space derivatives
+	// of s and t and sample trilinearly, otherwise always the base level
+	bool isMipMappingOn;
+
+	// drawEnvironmentMap keeps the last background it computed. The
+	// environment is infinitely far so only the camera's orientation and
+	// intrinsics (a, b, c) matter, moving the eye reuses the image
+	vector<unsigned int> envMapCache; // same layout as pix
+	unsigned int envMapCacheStamp; // CubeMap::getContentsStamp, 0 for none
+	V3 envMapCacheA, envMapCacheB, envMapCacheC;
+public:
+	static const int K_TILE_SIZE = 64; // tile width and height in pixels
+
+	// screen space setup of a triangle shared by the depth tested
+	// rasterizers: its edge expressions and its 1/w plane. Only depends on
+	// the projected vertices so callers that draw the same triangle from
+	// the same view again can compute it once and pass it in
+	struct TriangleSetup {
+		V3 eeqs[3]; // eeqs[0] = (A, B, C), where Au + Bv + C >= 0 inside
+		V3 depthABC; // 1/w = A*u + B*v + C
+		M33 baryMatrixInverse; // for lerping anything else in screen space
+	};
+	static void computeTriangleSetup(const V3 *const pvs, TriangleSetup &setup);
+	// just the edge expressions part of the above
+	static void computeEdgeEquations(const V3 *const pvs, V3 *eeqs);
+private:
+	// a triangle after setup: everything the rasterizers need besides the
+	// pixel rectangle to cover. The draw2D*Triangle functions build it once
+	// per triangle, with tiled rendering on it gets binned as is and each
+	// tile it overlaps only rasterizes its part
+	struct RasterTriangle {
+		enum RasterizerType { FLAT, SCREEN_SPACE, MODEL_SPACE, TEXTURED, SPRITE,
+			LIT, FLAT_WITH_DEPTH, STEALTH, REFLECTIVE, REFRACTIVE };
+		RasterizerType type;
+		int left, right, top, bottom; // pixel rectangle clipped to the frame
+		V3 pvs[3];
+		TriangleSetup setup; // FLAT and MODEL_SPACE only have the edge expressions
+		// persp correct coefficients (see slide 7 of RastParInterp.pdf), raster
+		// parameter = numABC * (u, v, 1) / denDEF * (u, v, 1)
+		V3 denDEF;
+		V3 colorNumABCs[3]; // red, green, blue. SCREEN_SPACE: screen space colors
+		V3 normalNumABCs[3]; // REFLECTIVE and REFRACTIVE only
+		V3 sNumABC, tNumABC;
+		V3 wNumABC; // MODEL_SPACE only
+		unsigned int color; // FLAT and FLAT_WITH_DEPTH
+		bool isTexturedOn; // STEALTH
+		ShadingMaterial material; // texture of all the textured types too
+		int materialId; // deferred shading
+	};
+	// fills in what all types have in common: type, vertices, pixel
+	// rectangle and setup (copied from setup if not null). False if the
+	// triangle can't show up (off the frame, or behind zb with the early
+	// depth test on), then the caller should skip the rest of the setup
+	bool setUpRasterTriangle(RasterTriangle::RasterizerType type, const V3 *const pvs,
+		const TriangleSetup *setup, RasterTriangle &tri);
+	// true if the whole triangle is behind zb over pixel rectangle
+	bool isTriangleOccluded(const TriangleSetup &setup, int left, int right, int top, int bottom) const;
+	// rasterizes tri right away, or bins it with tiled rendering on
+	void submitTriangle(const RasterTriangle &tri);
+	// rasterizes the part of tri inside pixel rectangle
+	void rasterizeTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeFlatTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeScreenSpaceTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeModelSpaceTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeTexturedTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeSprite(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeLitTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeFlatTriangleWithDepth(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	void rasterizeStealthTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+	// reflective and refractive only differ in material
+	void rasterizeEnvMappedTriangle(const RasterTriangle &tri, int left, int right, int top, int bottom);
+
+	// tile based rendering support. When on, triangles drawn with the
+	// draw2D*Triangle functions are set up right away but only binned by
+	// screen tile, flushTiles() rasterizes them later with a pool of worker
+	// threads, one tile per worker at a time. Tiles are a whole number of
+	// rasterizer blocks and the rasterizers never load or store outside the
+	// block they are in (see EdgeEvaluator), so each worker owns its tile's
+	// region of pix and zb.
+	bool isTiledRenderingOn;
+	int tilesU, tilesV; // number of tiles across and down
+	vector<RasterTriangle> binnedTriangles; // kept in submission order
+	vector<vector<unsigned int>> tileBins; // per tile indices into binnedTriangles
+public:
+
+	SWRenderTarget(unsigned int _w, unsigned int _h); // constructor, resolution
+	virtual ~SWRenderTarget();
+
+	// simple getters
+	int getWidth(void) const { return w; }
+	int getHeight(void) const { return h; }
+	unsigned int getPixAt(unsigned int index) const;
+	float getZbAt(unsigned int index) const;
+
+	// clear to background color
+	void set(unsigned int color);
+	// clear z buffer to far distance, corresponding to background
+	void clearZB(float farz);
+	// set one pixel function, check for frame boundaries
+	void setSafe(int u, int c, unsigned int color);
+	// set one pixel function
+	void set(int u, int c, unsigned int color);
+	// set to checkboard
+	void setCheckerboard(int checkerSize, unsigned int color0,
+		unsigned int color1);
+	// sets pixel to color c if wins z test
+	void setIfOneOverWCloser(const V3 &p, const V3 &c);
+	// sets pixel to color c if wins z test
+	void setIfWCloser(const V3 &p, const V3 &c);
+	// query if given 2D point (u,v,1/w) is closer that what is
+	// is stored in the zb
+	bool isDepthTestPass(const V3 &p, float epsilon);
+
+	// tile based rendering control. With tiled rendering on, triangles drawn
+	// with the draw2D*Triangle functions don't show up in pix and zb until
+	// flushTiles() is called
+	void setIsTiledRenderingOn(bool value);
+	bool getIsTiledRenderingOn(void) const { return isTiledRenderingOn; }
+	// rasterizes all binned triangles in parallel and empties the bins
+	void flushTiles(void);
+
+	// early depth test control. When on, rasterizers consult the Hi-Z to
+	// throw away whole triangles and whole blocks that are behind zb before
+	// doing any shading
+	void setIsEarlyDepthTestOn(bool value);
+	bool getIsEarlyDepthTestOn(void) const { return isEarlyDepthTestOn; }
+
+	// deferred shading control. With deferred shading on, lit, reflective and
+	// refractive triangles don't show up in pix until resolveDeferredShading()
+	// is called, which has to happen once all geometry of the frame is drawn
+	void setIsDeferredShadingOn(bool value);
+	bool getIsDeferredShadingOn(void) const { return isDeferredShadingOn; }
+
+	// mip mapping control
+	void setIsMipMappingOn(bool value) { isMipMappingOn = value; }
+	bool getIsMipMappingOn(void) const { return isMipMappingOn; }
+	// shading pass: shades every pixel left in the G-buffer and clears it
+	void resolveDeferredShading(void);
+
+	// draw 2D circle with no depth test
+	void draw2DCircle(float cuf, float cvf, float radius, unsigned int color);
+	// draw 2D circle only where its closer
+	void draw2DCircleIfCloser(const V3 &p, float radius, const V3 &color);
+	// draw axis aligned rectangle with no depth test
+	void draw2DRectangle(float llu, float llv, float width, float height, unsigned int color);
+	// draw single color 2D triangle with no depth test
+	// Quick note on pointers vs references: int &x =  y is the same as const int * x = &y
+	void draw2DFlatTriangle(
+		V3 *const pvs,
+		unsigned int color);
+	// draw 2D triangle using barycentric interpolation of colors (screen space interpolation)
+	// and depth test
+	void draw2DFlatTriangleScreenSpace(
+		V3 *const pvs,
+		V3 *const cols,
+		const TriangleSetup *setup = nullptr);
+	// draw 2D triangle using perspectively correct interpolation of colors and depth test
+	void draw2DFlatTriangleModelSpace(
+		V3 *const pvs,
+		V3 *const cols,
+		M33 perspCorrectMatQ);
+	// draw 2D triangle using model space linear interpolation of s,t and 
+	// screen space linar interpolation of depth test. Reason being that 1/w
+	// gives us greater precision for near depth test as opposed to w which 
+	// givues us better precision for far depth test which we don't care as much
+	void draw2DTexturedTriangle(
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		M33 perspCorrectMatQ,
+		const Texture &texture,
+		const TriangleSetup *setup = nullptr);
+	// draw sprite using model space linear interpolation of s,t and 
+	// screen space linar interpolation of depth test.
+	void draw2DSprite(
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		M33 perspCorrectMatQ,
+		const Texture &texture,
+		const TriangleSetup *setup = nullptr);
+	// draws 2D textured triangle with lighting and depth test
+	// colors and texture uvs are interpolated in model space
+	// while 1/w is interpolated in screen coordinates.
+	// texturing is optional off by default unless a texture object
+	// is passed. Simmilarly support for shadow mapping can be requested
+	// optionally thorugh interface
+	void draw2DLitTriangle(
+		V3 *const vs,
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 *const normals,
+		const Light &light,
+		M33 perspCorrectMatQ,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		const Texture *const texture,
+		bool isShadowMapOn,
+		const PPC &cam,
+		bool isLightProjOn,
+		const LightProjector *const lightProj,
+		const TriangleSetup *setup = nullptr);
+	// draw single color 2D triangle with depth test. Used for 
+	// building the shadow maps
+	void draw2DFlatTriangleWithDepth(
+		V3 *const pvs,
+		unsigned int color,
+		const TriangleSetup *setup = nullptr);
+	// draws 2D textured triangle in stealth mode so that it gets cammouflaged 
+	// with its environment (by using projective texturing)
+	void draw2DStealthTriangle(
+		V3 *const vs,
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 *const normals,
+		const Light &light,
+		M33 perspCorrectMatQ,
+		bool isLightOn,
+		bool isTexturedOn,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		const Texture *const texture,
+		const PPC &cam,
+		const LightProjector & lightProj,
+		const TriangleSetup *setup = nullptr);
+	// draws a 2D triangle with metallic appereance that is reflective in nature
+	// by using an environment map.
+	void draw2DReflectiveTriangle(
+		CubeMap &cubeMap,
+		const PPC &cam,
+		V3 *const vs,
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 *const normals,
+		M33 perspCorrectMatQ,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		const Texture *const texture,
+		const TriangleSetup *setup = nullptr);
+	// draws a 2D triangle with glassy appereance that is refractive in nature
+	// by using an environment map.
+	void draw2DRefractiveTriangle(
+		float nl, float nt, // nl = refractive index for medium, nt = refractive index of TMesh material
+		CubeMap &cubeMap,
+		const PPC &cam,
+		V3 *const vs,
+		V3 *const pvs,
+		V3 *const cols,
+		const V3 *const normals,
+		M33 perspCorrectMatQ,
+		const V3 &sCoords,
+		const V3 &tCoords,
+		const Texture *const texture,
+		const TriangleSetup *setup = nullptr);
+
+	// draw 2D segment specified by 2 points, each with own color
+	void draw2DSegment(const V3 &v0, const V3 &c0, const V3 &v1, const V3 &c1);
+
+	// draws distant geometry using an environment map. Rows are spread over
+	// the worker pool and the result is reused while the camera only moves
+	void drawEnvironmentMap(CubeMap &cubeMap, const PPC &cam);
+
+	// save as png image in the pngs folder
+	void saveAsPng(string fname) const;
+	// save as png image at any path, returns false on failure
+	bool saveAsPngFile(const string &path) const;
+	// copy color buffer of another render target of the same size
+	void copyPixels(const SWRenderTarget &other);
+	// load from png image
+	void loadFromPng(string fname);
+	// load from texture object
+	void loadFromTexture(const Texture &texObj);
+};
+
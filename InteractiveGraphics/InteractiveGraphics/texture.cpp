@@ -1,4 +1,5 @@
 #include "texture.h"
+#include "textureregistry.h"
 #include "lodepng.h"
 #include "v3.h"
 using std::size_t;
@@ -8,16 +9,142 @@ using std::cerr;
 #include <algorithm>
 using std::min;
 using std::max;
+#include <cmath>
+#include <cstring>
+#include <fstream>
+using std::ifstream;
+using std::ofstream;
+using std::ios;
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// SSE2 is baseline for x64 and the default /arch for x86 since VS2012
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TEXTURE_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define TEXTURE_USE_SSE 0
+#endif
+// AVX2 builds (/arch:AVX2, -mavx2) fetch row major texels with a real gather
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-void Texture::loadPngTexture(const string &filename)
+bool Texture::loadPngTexture(const string &filename, TexelImage &image)
 {
 	//decode
-	unsigned error = lodepng::decode(texels, texWidth, texHeight, filename.c_str());
+	unsigned error = lodepng::decode(image.texels, image.width, image.height, filename.c_str());
 
 	//if there's an error, display it
-	if (error) std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+	if (error) {
+		std::cout << "decoder error " << error << ": " << lodepng_error_text(error) << std::endl;
+		return false;
+	}
 
 	//the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw it, ...
+	return true;
+}
+
+// binary texture cache header. Dimensions of each level follow it
+struct BinaryCacheHeader {
+	char magic[4]; // "ITEX"
+	unsigned int version; // K_BINARY_CACHE_VERSION
+	unsigned int format; // 0 is RGBA8, the only one for now
+	unsigned int width, height;
+	unsigned int levelsN; // base level included
+};
+
+bool Texture::loadBinaryCache(const string &filename, TexelImage &image)
+{
+	ifstream ifs(filename, ios::binary);
+	if (ifs.fail())
+		return false;
+
+	BinaryCacheHeader header;
+	ifs.read((char *)&header, sizeof(header));
+	if (!ifs || memcmp(header.magic, "ITEX", 4) != 0 ||
+		header.version != K_BINARY_CACHE_VERSION || header.format != 0 ||
+		header.levelsN == 0 || header.levelsN > 32) {
+		cerr << "WARNING: ignoring bad texture cache file " << filename << endl;
+		return false;
+	}
+	vector<unsigned int> levelSizes(header.levelsN * 2);
+	ifs.read((char *)levelSizes.data(), levelSizes.size() * sizeof(unsigned int));
+	bool isChainValid = (bool)ifs && header.width > 0 && header.height > 0 &&
+		levelSizes[0] == header.width && levelSizes[1] == header.height;
+	// has to be the chain buildMipChain makes: every level half the one
+	// before (at least 1), down to 1x1 and not further
+	for (unsigned int i = 1; i < header.levelsN && isChainValid; i++) {
+		isChainValid = levelSizes[i * 2 - 2] > 1 || levelSizes[i * 2 - 1] > 1;
+		isChainValid = isChainValid &&
+			levelSizes[i * 2] == max(1u, levelSizes[i * 2 - 2] / 2) &&
+			levelSizes[i * 2 + 1] == max(1u, levelSizes[i * 2 - 1] / 2);
+	}
+	unsigned int lastLevel = header.levelsN - 1;
+	if (!isChainValid || levelSizes[lastLevel * 2] != 1 || levelSizes[lastLevel * 2 + 1] != 1) {
+		cerr << "WARNING: ignoring bad texture cache file " << filename << endl;
+		return false;
+	}
+
+	image.width = header.width;
+	image.height = header.height;
+	image.mips.resize(header.levelsN - 1);
+	for (unsigned int i = 0; i < header.levelsN; i++) {
+		vector<unsigned char> &levelTexels = (i == 0) ? image.texels : image.mips[i - 1].texels;
+		if (i > 0) {
+			image.mips[i - 1].width = levelSizes[i * 2];
+			image.mips[i - 1].height = levelSizes[i * 2 + 1];
+		}
+		// straight into the level's storage, no intermediate copy
+		levelTexels.resize((size_t)levelSizes[i * 2] * levelSizes[i * 2 + 1] * 4);
+		ifs.read((char *)levelTexels.data(), levelTexels.size());
+		if (!ifs) {
+			cerr << "WARNING: texture cache file " << filename << " is truncated" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Texture::saveBinaryCache(const string &filename) const
+{
+	if (texWidth == 0 || texHeight == 0)
+		return false; // nothing loaded
+
+	ofstream ofs(filename, ios::binary);
+	if (ofs.fail()) {
+		cerr << "ERROR: cannot write texture cache file " << filename << endl;
+		return false;
+	}
+	BinaryCacheHeader header;
+	memcpy(header.magic, "ITEX", 4);
+	header.version = K_BINARY_CACHE_VERSION;
+	header.format = 0;
+	header.width = texWidth;
+	header.height = texHeight;
+	header.levelsN = 1 + (unsigned int)image->mips.size();
+	ofs.write((const char *)&header, sizeof(header));
+	ofs.write((const char *)&texWidth, sizeof(unsigned int));
+	ofs.write((const char *)&texHeight, sizeof(unsigned int));
+	for (const MipLevel &level : image->mips) {
+		ofs.write((const char *)&level.width, sizeof(unsigned int));
+		ofs.write((const char *)&level.height, sizeof(unsigned int));
+	}
+	ofs.write((const char *)image->texels.data(), image->texels.size());
+	for (const MipLevel &level : image->mips)
+		ofs.write((const char *)level.texels.data(), level.texels.size());
+	return (bool)ofs;
+}
+
+// true if the file at path exists and was modified after the one at other
+static bool isFileNewer(const string &path, const string &other)
+{
+	struct stat pathStat, otherStat;
+	if (stat(path.c_str(), &pathStat) != 0)
+		return false;
+	if (stat(other.c_str(), &otherStat) != 0)
+		return true; // png is gone, the cache is all there is
+	return pathStat.st_mtime >= otherStat.st_mtime;
 }
 
 float Texture::clip(float n, float lower, float upper) const
@@ -25,10 +152,43 @@ float Texture::clip(float n, float lower, float upper) const
 	return max(lower, min(n, upper));
 }
 
-Texture::Texture(const string &filename)
+size_t Texture::TexelImage::getSizeInBytes(void) const
+{
+	size_t bytes = texels.size();
+	for (const MipLevel &level : mips)
+		bytes += level.texels.size();
+	return bytes;
+}
+
+// shared by every texture that failed to load
+static const shared_ptr<const Texture::TexelImage> &getEmptyImage(void)
+{
+	static const shared_ptr<const Texture::TexelImage> emptyImage =
+		std::make_shared<const Texture::TexelImage>(Texture::TexelImage{ {}, 0, 0, {} });
+	return emptyImage;
+}
+
+Texture::Texture(const string &filename) :
+	image(getEmptyImage()),
+	texWidth(0),
+	texHeight(0),
+	texelLayout(TexelLayout::ROW_MAJOR),
+	isFixedPointFilteringOn(false)
 {
 	if (filename.find(".png") != std::string::npos) {
-		loadPngTexture(filename);
+		shared_ptr<const TexelImage> pngImage = TextureRegistry::acquire(filename, [&filename]() {
+			shared_ptr<TexelImage> newImage = std::make_shared<TexelImage>();
+			string cacheFilename = getBinaryCachePath(filename);
+			if (isFileNewer(cacheFilename, filename) && loadBinaryCache(cacheFilename, *newImage))
+				return newImage;
+			*newImage = TexelImage(); // drop what a bad cache file left
+			if (!loadPngTexture(filename, *newImage))
+				return shared_ptr<TexelImage>(); // don't register failures
+			buildMipChain(*newImage);
+			return newImage;
+		});
+		if (pngImage)
+			setImage(pngImage, filename);
 	}
 	else if (filename.find(".tiff") != std::string::npos) {
 		cerr << "ERROR: tiff support is still under construction..."  << endl;
@@ -40,37 +200,154 @@ Texture::Texture(const string &filename)
 
 Texture::Texture(const Texture & otherTexture, 
 	unsigned int beginS, unsigned int endS, 
-	unsigned int beginT, unsigned int endT)
+	unsigned int beginT, unsigned int endT) :
+	image(getEmptyImage()),
+	texWidth(0),
+	texHeight(0),
+	// sub textures sample like their source
+	texelLayout(otherTexture.texelLayout),
+	isFixedPointFilteringOn(otherTexture.isFixedPointFilteringOn)
 {
-	if((beginS > endS) || (beginT > endT))
+	if((beginS > endS) || (beginT > endT) ||
+		(endS > otherTexture.texWidth) || (endT > otherTexture.texHeight))
 		cerr << "ERROR: Bad parameters supplied to Texture constructor..." << endl;
 	else {
+		const TexelImage &otherImage = *otherTexture.image;
+		auto buildSubImage = [&]() {
+			shared_ptr<TexelImage> newImage = std::make_shared<TexelImage>();
+			newImage->width = endS - beginS;
+			newImage->height = endT - beginT;
+			newImage->texels.reserve((size_t)newImage->width * newImage->height * 4);
+			for (unsigned int i = beginT; i < endT; i++) {
+				// copy row by row from the other texture
+				const unsigned char *row = &otherImage.texels[(i * otherImage.width + beginS) * 4];
+				newImage->texels.insert(newImage->texels.end(), row, row + newImage->width * 4);
+			}
+			buildMipChain(*newImage);
+			return newImage;
+		};
 
-		texWidth = endS - beginS;
-		texHeight = endT - beginT;
-
-		unsigned int texelIndex;
-		unsigned char red, green, blue, alpha;
-		for (unsigned int i = beginT; i < endT; i++) {
-			for (unsigned int j = beginS; j < endS; j++) {
-
-				// grab pixel from other texture
-				texelIndex = (i * otherTexture.texWidth + j) * 4;
-				red = otherTexture.texels[texelIndex + 0];
-				green = otherTexture.texels[texelIndex + 1];
-				blue = otherTexture.texels[texelIndex + 2];
-				alpha = otherTexture.texels[texelIndex + 3];
-
-				// copy into tihs texture
-				texels.push_back(red);
-				texels.push_back(green);
-				texels.push_back(blue);
-				texels.push_back(alpha);
+		if (otherTexture.registryKey.empty()) {
+			setImage(buildSubImage(), "");
+		}
+		else {
+			// e.g. every CubeMap of the same cross image shares its faces
+			string key = otherTexture.registryKey + "[" +
+				std::to_string(beginS) + "," + std::to_string(endS) + ")x[" +
+				std::to_string(beginT) + "," + std::to_string(endT) + ")";
+			setImage(TextureRegistry::acquire(key, buildSubImage), key);
+		}
+	}
+}
+
+void Texture::setImage(const shared_ptr<const TexelImage> &newImage, const string &key)
+{
+	image = newImage;
+	texWidth = image->width;
+	texHeight = image->height;
+	registryKey = key;
+	buildTiledTexels();
+}
+
+void Texture::buildMipChain(TexelImage &image)
+{
+	image.mips.clear();
+	if (image.width == 0 || image.height == 0 ||
+		image.texels.size() < (size_t)image.width * image.height * 4)
+		return; // nothing loaded
+
+	const unsigned char *srcTexels = image.texels.data();
+	unsigned int srcWidth = image.width, srcHeight = image.height;
+	while (srcWidth > 1 || srcHeight > 1) {
+		MipLevel level;
+		level.width = max(1u, srcWidth / 2);
+		level.height = max(1u, srcHeight / 2);
+		level.texels.resize(level.width * level.height * 4);
+		for (unsigned int i = 0; i < level.height; i++) {
+			// odd sizes drop their last row/column, 1 texel wide levels
+			// average the same texel twice
+			unsigned int i0 = 2 * i, i1 = min(2 * i + 1, srcHeight - 1);
+			for (unsigned int j = 0; j < level.width; j++) {
+				unsigned int j0 = 2 * j, j1 = min(2 * j + 1, srcWidth - 1);
+				for (unsigned int z = 0; z < 4; z++) {
+					unsigned int sum =
+						srcTexels[(i0 * srcWidth + j0) * 4 + z] +
+						srcTexels[(i0 * srcWidth + j1) * 4 + z] +
+						srcTexels[(i1 * srcWidth + j0) * 4 + z] +
+						srcTexels[(i1 * srcWidth + j1) * 4 + z];
+					level.texels[(i * level.width + j) * 4 + z] = (unsigned char)((sum + 2) / 4);
+				}
 			}
 		}
+		image.mips.push_back(level);
+		// vector may have moved the previous levels, refer to the new one
+		srcTexels = image.mips.back().texels.data();
+		srcWidth = image.mips.back().width;
+		srcHeight = image.mips.back().height;
+	}
+}
+
+// scatters a row major RGBA8 image into its tiled layout
+static void tileTexels(const vector<unsigned char> &src,
+	unsigned int width, unsigned int height, vector<unsigned char> &dst)
+{
+	unsigned int tileSize = Texture::K_TEXEL_TILE_SIZE;
+	unsigned int tilesPerRow = (width + tileSize - 1) / tileSize;
+	unsigned int tileRowsN = (height + tileSize - 1) / tileSize;
+	// partial tiles at the right and bottom edges are padded
+	dst.assign((size_t)tilesPerRow * tileRowsN * tileSize * tileSize * 4, 0);
+	for (unsigned int t = 0; t < height; t++) {
+		for (unsigned int s = 0; s < width; s++) {
+			unsigned int tileIndex = (t / tileSize) * tilesPerRow + s / tileSize;
+			unsigned int inS = s % tileSize, inT = t % tileSize;
+			unsigned int inTile = (inS & 1) | ((inT & 1) << 1) | ((inS & 2) << 1) | ((inT & 2) << 2);
+			unsigned int dstIndex = (tileIndex * tileSize * tileSize + inTile) * 4;
+			unsigned int srcIndex = (t * width + s) * 4;
+			for (unsigned int z = 0; z < 4; z++)
+				dst[dstIndex + z] = src[srcIndex + z];
+		}
 	}
 }
 
+void Texture::buildTiledTexels(void)
+{
+	// don't keep a second copy of the image around for nothing
+	vector<vector<unsigned char>>().swap(tiledLevels);
+	if (texelLayout != TexelLayout::TILED || texWidth == 0 || texHeight == 0)
+		return; // nothing to tile
+	tiledLevels.resize(1 + image->mips.size());
+	tileTexels(image->texels, texWidth, texHeight, tiledLevels[0]);
+	for (size_t i = 0; i < image->mips.size(); i++)
+		tileTexels(image->mips[i].texels, image->mips[i].width, image->mips[i].height, tiledLevels[i + 1]);
+}
+
+void Texture::setTexelLayout(TexelLayout layout)
+{
+	texelLayout = layout;
+	buildTiledTexels();
+}
+
+Texture::LevelView Texture::getLevelView(int level) const
+{
+	LevelView view;
+	bool isTiled = (texelLayout == TexelLayout::TILED) && !tiledLevels.empty();
+	if (level == 0) {
+		view.texels = image->texels.data();
+		view.width = texWidth;
+		view.height = texHeight;
+	}
+	else {
+		const MipLevel &mip = image->mips[level - 1];
+		view.texels = mip.texels.data();
+		view.width = mip.width;
+		view.height = mip.height;
+	}
+	if (isTiled)
+		view.texels = tiledLevels[level].data();
+	view.tilesPerRow = isTiled ? (view.width + K_TEXEL_TILE_SIZE - 1) / K_TEXEL_TILE_SIZE : 0;
+	return view;
+}
+
 unsigned int Texture::sampleTexNearClamp(float floatS, float floatT) const
 {
 	// clamps [0-1] and then maps to [0, texWidth - 1]
@@ -85,11 +362,12 @@ unsigned int Texture::sampleTexNearClamp(float floatS, float floatT) const
 	unsigned char red, green, blue, alpha;
 	unsigned int sampleColor;
 	
-	unsigned int texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];
+	LevelView base = getLevelView(0);
+	unsigned int texelIndex = getTexelOffset(base, intS, intT);
+	red = base.texels[texelIndex + 0];
+	green = base.texels[texelIndex + 1];
+	blue = base.texels[texelIndex + 2];
+	alpha = base.texels[texelIndex + 3];
 
 	((unsigned char*)(&sampleColor))[0] = red;
 	((unsigned char*)(&sampleColor))[1] = green;
@@ -118,11 +396,12 @@ unsigned int Texture::sampleTexNearTile(float floatS, float floatT) const
 	unsigned char red, green, blue, alpha;
 	unsigned int sampleColor;
 
-	unsigned int texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];
+	LevelView base = getLevelView(0);
+	unsigned int texelIndex = getTexelOffset(base, intS, intT);
+	red = base.texels[texelIndex + 0];
+	green = base.texels[texelIndex + 1];
+	blue = base.texels[texelIndex + 2];
+	alpha = base.texels[texelIndex + 3];
 
 	((unsigned char*)(&sampleColor))[0] = red;
 	((unsigned char*)(&sampleColor))[1] = green;
@@ -134,15 +413,117 @@ unsigned int Texture::sampleTexNearTile(float floatS, float floatT) const
 
 unsigned int Texture::sampleTexBilinearTile(float floatS, float floatT) const
 {
+	if (isFixedPointFilteringOn)
+		return sampleLevelBilinearFixed(getLevelView(0), floatS, floatT, false);
+	return sampleLevelBilinearTile(getLevelView(0), floatS, floatT).getColor();
+}
+
+unsigned int Texture::sampleTexBilinearClamp(float floatS, float floatT) const
+{
+	return sampleLevelBilinearFixed(getLevelView(0), floatS, floatT, true);
+}
+
+// lerps two packed RGBA8 colors, weight in [0, 256] is how much of c1.
+// Two channels are blended at once in the 0x00FF00FF lanes: 255 * 256 plus
+// the rounding term still fits in 16 bits so lanes never carry into each other
+static inline unsigned int lerpPacked(unsigned int c0, unsigned int c1, unsigned int weight)
+{
+	unsigned int invWeight = 256 - weight;
+	unsigned int rb = ((c0 & 0x00FF00FF) * invWeight + (c1 & 0x00FF00FF) * weight + 0x00800080) >> 8;
+	unsigned int ga = (((c0 >> 8) & 0x00FF00FF) * invWeight + ((c1 >> 8) & 0x00FF00FF) * weight + 0x00800080) >> 8;
+	return (rb & 0x00FF00FF) | ((ga & 0x00FF00FF) << 8);
+}
+
+// texel pair and 8 bit weight (how much of texel1) along one axis, with
+// the same texel addressing as the float path sampleLevelBilinearTile:
+// s is tiled (negatives clip to 0), then x = s * (size - 1) and the pair
+// is picked by which half of texel x falls in. x * 256 is exact, so the
+// integer and fractional parts split the same way as in the float path
+static inline void getTileTexelPair(float s, unsigned int size,
+	unsigned int &texel0, unsigned int &texel1, unsigned int &weight)
+{
+	if (s > 1.0f)
+		s -= (float)(int)s;
+	s = (s < 0.0f) ? 0.0f : ((s > 1.0f) ? 1.0f : s);
+	int fixedX = (int)(s * (float)(size - 1) * 256.0f);
+	unsigned int i = (unsigned int)fixedX >> 8, f = (unsigned int)fixedX & 0xFF;
+	if (f >= 128) { // past the center of texel i
+		texel0 = i;
+		weight = f - 128;
+	}
+	else if (i > 0) { // the float path shifts the grid one texel back
+		texel0 = i - 1;
+		weight = f;
+	}
+	else { // and wraps the first half texel to the last pair
+		texel0 = (size >= 2) ? size - 2 : 0;
+		weight = f + 128;
+	}
+	texel1 = (texel0 + 1 < size) ? texel0 + 1 : 0;
+}
+
+static inline unsigned int clampTexelCoord(int i, unsigned int size)
+{
+	return (unsigned int)((i < 0) ? 0 : ((i >= (int)size) ? (int)size - 1 : i));
+}
+
+unsigned int Texture::sampleLevelBilinearFixed(const LevelView &level,
+	float floatS, float floatT, bool isClamped) const
+{
+	unsigned int s0, s1, t0, t1;
+	unsigned int weightS, weightT; // 8 bit fractions, 0 means all of texel 0
+	if (isClamped) {
+		floatS = clip(floatS, 0.0f, 1.0f);
+		floatT = clip(floatT, 0.0f, 1.0f);
+		// texel i covers [i, i + 1) / size, so its center is at i + 0.5.
+		// In 24.8 fixed point, biased by one texel so the conversion always
+		// truncates a positive number (samples reach half a texel left of 0)
+		int fixedS = (int)((floatS * (float)level.width + 0.5f) * 256.0f);
+		int fixedT = (int)((floatT * (float)level.height + 0.5f) * 256.0f);
+		int baseS = (fixedS >> 8) - 1, baseT = (fixedT >> 8) - 1;
+		weightS = (unsigned int)fixedS & 0xFF;
+		weightT = (unsigned int)fixedT & 0xFF;
+		s0 = clampTexelCoord(baseS, level.width);
+		s1 = clampTexelCoord(baseS + 1, level.width);
+		t0 = clampTexelCoord(baseT, level.height);
+		t1 = clampTexelCoord(baseT + 1, level.height);
+	}
+	else {
+		// matches the float path, see getTileTexelPair
+		getTileTexelPair(floatS, level.width, s0, s1, weightS);
+		getTileTexelPair(floatT, level.height, t0, t1, weightT);
+	}
+	// t needs to be inverted
+	t0 = (level.height - 1) - t0;
+	t1 = (level.height - 1) - t1;
+
+	// texels are RGBA bytes, same as the packed colors in memory
+	unsigned int c00, c10, c01, c11;
+	memcpy(&c00, level.texels + getTexelOffset(level, s0, t0), 4);
+	memcpy(&c10, level.texels + getTexelOffset(level, s1, t0), 4);
+	memcpy(&c01, level.texels + getTexelOffset(level, s0, t1), 4);
+	memcpy(&c11, level.texels + getTexelOffset(level, s1, t1), 4);
+
+	return lerpPacked(
+		lerpPacked(c00, c10, weightS),
+		lerpPacked(c01, c11, weightS),
+		weightT);
+}
+
+V3 Texture::sampleLevelBilinearTile(const LevelView &level, float floatS, float floatT) const
+{
+	const unsigned char *levelTexels = level.texels;
+	unsigned int levelWidth = level.width, levelHeight = level.height;
+
 	// tile s,t by only keeping decimal part
 	if (floatS > 1.0)
 		floatS = floatS - ((int)floatS);
 	if (floatT > 1.0)
 		floatT = floatT - ((int)floatT);
-	// clips negative numbers and then maps [0,1) to [0, texWidth - 1]
-	floatS = clip(floatS, 0.0f, 1.0f) * (texWidth - 1);
-	// clips negative numbers and then maps [0,1) to [0, texHeight - 1]
-	floatT = clip(floatT, 0.0f, 1.0f) * (texHeight - 1);
+	// clips negative numbers and then maps [0,1) to [0, levelWidth - 1]
+	floatS = clip(floatS, 0.0f, 1.0f) * (levelWidth - 1);
+	// clips negative numbers and then maps [0,1) to [0, levelHeight - 1]
+	floatT = clip(floatT, 0.0f, 1.0f) * (levelHeight - 1);
 	
 	// get decimal parts
 	float dS = floatS - ((int)floatS);
@@ -157,7 +538,7 @@ unsigned int Texture::sampleTexBilinearTile(float floatS, float floatT) const
 		floatS--;
 		// wrap around
 		if (floatS < 0.0f) {
-			floatS = (float) ((texWidth - 1) + dS);
+			floatS = (float) ((levelWidth - 1) + dS);
 		}
 		// adjust ds relative to new grid
 		dS = floatS - ((int)floatS);
@@ -167,7 +548,7 @@ unsigned int Texture::sampleTexBilinearTile(float floatS, float floatT) const
 		floatT--;
 		// wrap around
 		if (floatT < 0.0f) {
-			floatT = (float)(texHeight - 1 + dT);
+			floatT = (float)(levelHeight - 1 + dT);
 		}
 		// adjust dt relative to new grid
 		dT = floatT - ((int)floatT);
@@ -181,51 +562,51 @@ unsigned int Texture::sampleTexBilinearTile(float floatS, float floatT) const
 	// compute C0
 	unsigned int intS = baseS;
 	unsigned int intT = baseT;
-	intT = intT = (texHeight - 1) - intT; // t needs to be inverted
-	unsigned int texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];	
+	intT = intT = (levelHeight - 1) - intT; // t needs to be inverted
+	unsigned int texelIndex = getTexelOffset(level, intS, intT);
+	red = levelTexels[texelIndex + 0];
+	green = levelTexels[texelIndex + 1];
+	blue = levelTexels[texelIndex + 2];
+	alpha = levelTexels[texelIndex + 3];	
 	V3 C0((float)red / 255.0f, (float)green / 255.0f, (float)blue / 255.0f);
 	
 	// compute C1
 	intS = baseS;
-	intT = (baseT + 1) % (texHeight);
-	intT = intT = (texHeight - 1) - intT; // t needs to be inverted
-	texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];
+	intT = (baseT + 1) % (levelHeight);
+	intT = intT = (levelHeight - 1) - intT; // t needs to be inverted
+	texelIndex = getTexelOffset(level, intS, intT);
+	red = levelTexels[texelIndex + 0];
+	green = levelTexels[texelIndex + 1];
+	blue = levelTexels[texelIndex + 2];
+	alpha = levelTexels[texelIndex + 3];
 	V3 C1((float)red / 255.0f, (float)green / 255.0f, (float)blue / 255.0f);
 
 	// compute C2
-	intS = (baseS + 1) % (texWidth);
-	intT = (baseT + 1) % (texHeight);
-	intT = intT = (texHeight - 1) - intT; // t needs to be inverted
-	texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];
+	intS = (baseS + 1) % (levelWidth);
+	intT = (baseT + 1) % (levelHeight);
+	intT = intT = (levelHeight - 1) - intT; // t needs to be inverted
+	texelIndex = getTexelOffset(level, intS, intT);
+	red = levelTexels[texelIndex + 0];
+	green = levelTexels[texelIndex + 1];
+	blue = levelTexels[texelIndex + 2];
+	alpha = levelTexels[texelIndex + 3];
 	V3 C2((float)red / 255.0f, (float)green / 255.0f, (float)blue / 255.0f);
 
 	// compute C3
-	intS = (baseS + 1) % (texWidth);
+	intS = (baseS + 1) % (levelWidth);
 	intT = baseT;
-	intT = intT = (texHeight - 1) - intT; // t needs to be inverted
-	texelIndex = (intT * texWidth + intS) * 4;
-	red = texels[texelIndex + 0];
-	green = texels[texelIndex + 1];
-	blue = texels[texelIndex + 2];
-	alpha = texels[texelIndex + 3];
+	intT = intT = (levelHeight - 1) - intT; // t needs to be inverted
+	texelIndex = getTexelOffset(level, intS, intT);
+	red = levelTexels[texelIndex + 0];
+	green = levelTexels[texelIndex + 1];
+	blue = levelTexels[texelIndex + 2];
+	alpha = levelTexels[texelIndex + 3];
 	V3 C3((float)red / 255.0f, (float)green / 255.0f, (float)blue / 255.0f);
 	
 	V3 bilinearResult = C0 * ((1 - dS) * (1 - dT)) + C1 * ((1 - dS) * dT)
 		+ C2 * (dS * dT) + C3 * (dS * (1 - dT));
 
-	return bilinearResult.getColor();
+	return bilinearResult;
 #if 0
 --C0-----C3--
    |     |
@@ -234,8 +615,209 @@ unsigned int Texture::sampleTexBilinearTile(float floatS, float floatT) const
 #endif
 }
 
+float Texture::computeLod(float dsdu, float dtdu, float dsdv, float dtdv) const
+{
+	// texel footprint of one pixel step along u and along v, the
+	// longer one decides (isotropic filtering)
+	float dsu = dsdu * texWidth, dtu = dtdu * texHeight;
+	float dsv = dsdv * texWidth, dtv = dtdv * texHeight;
+	float rhoSq = max(dsu * dsu + dtu * dtu, dsv * dsv + dtv * dtv);
+	if (rhoSq <= 1.0f)
+		return 0.0f; // magnification
+	// log2(sqrt(rhoSq))
+	float lod = 0.5f * log2f(rhoSq);
+	return min(lod, (float)(getMipLevelsN() - 1));
+}
+
+unsigned int Texture::sampleTexTrilinearTile(float floatS, float floatT, float lod) const
+{
+	if (lod <= 0.0f || image->mips.empty())
+		return sampleTexBilinearTile(floatS, floatT);
+
+	int level0 = (int)lod;
+	float dLod = lod - (float)level0;
+	if (level0 >= (int)image->mips.size()) {
+		// coarsest level, nothing to blend with
+		if (isFixedPointFilteringOn)
+			return sampleLevelBilinearFixed(getLevelView((int)image->mips.size()), floatS, floatT, false);
+		return sampleLevelBilinearTile(getLevelView((int)image->mips.size()),
+			floatS, floatT).getColor();
+	}
+	if (isFixedPointFilteringOn) {
+		return lerpPacked(
+			sampleLevelBilinearFixed(getLevelView(level0), floatS, floatT, false),
+			sampleLevelBilinearFixed(getLevelView(level0 + 1), floatS, floatT, false),
+			(unsigned int)(dLod * 256.0f));
+	}
+
+	V3 C0 = sampleLevelBilinearTile(getLevelView(level0), floatS, floatT);
+	V3 C1 = sampleLevelBilinearTile(getLevelView(level0 + 1), floatS, floatT);
+
+	V3 trilinearResult = C0 * (1.0f - dLod) + C1 * dLod;
+	return trilinearResult.getColor();
+}
+
+#if TEXTURE_USE_SSE
+// lerpPacked for 4 colors, one weight in [0, 256] per 32 bit lane. Same
+// two channels per lane idea, the 16 bit multiplies keep them apart
+static inline __m128i lerpPackedQuad(__m128i c0, __m128i c1, __m128i weight)
+{
+	const __m128i lowBytes = _mm_set1_epi32(0x00FF00FF);
+	const __m128i round = _mm_set1_epi16(0x80);
+	__m128i weight16 = _mm_or_si128(weight, _mm_slli_epi32(weight, 16));
+	__m128i invWeight16 = _mm_sub_epi16(_mm_set1_epi16(256), weight16);
+	// red and blue in the low byte of each 16 bit lane
+	__m128i rb = _mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(_mm_and_si128(c0, lowBytes), invWeight16),
+		_mm_mullo_epi16(_mm_and_si128(c1, lowBytes), weight16)), round);
+	// green and alpha
+	__m128i ga = _mm_add_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(_mm_srli_epi16(c0, 8), invWeight16),
+		_mm_mullo_epi16(_mm_srli_epi16(c1, 8), weight16)), round);
+	return _mm_or_si128(_mm_srli_epi16(rb, 8), _mm_andnot_si128(lowBytes, ga));
+}
+
+// four lanes of getTileTexelPair, size needs to be at least 2
+static inline void getTileTexelPairQuad(__m128 s, unsigned int size,
+	__m128i &texel0, __m128i &texel1, __m128i &weight)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128i halfTexel = _mm_set1_epi32(128);
+	s = _mm_sub_ps(s, _mm_and_ps(_mm_cmpgt_ps(s, one),
+		_mm_cvtepi32_ps(_mm_cvttps_epi32(s))));
+	s = _mm_min_ps(_mm_max_ps(s, _mm_setzero_ps()), one);
+	__m128i fixedX = _mm_cvttps_epi32(_mm_mul_ps(
+		_mm_mul_ps(s, _mm_set1_ps((float)(size - 1))), _mm_set1_ps(256.0f)));
+	__m128i i = _mm_srli_epi32(fixedX, 8);
+	__m128i f = _mm_and_si128(fixedX, _mm_set1_epi32(0xFF));
+	__m128i isUpperHalf = _mm_cmpgt_epi32(f, _mm_set1_epi32(127));
+	__m128i isWrapped = _mm_andnot_si128(isUpperHalf, _mm_cmpeq_epi32(i, _mm_setzero_si128()));
+	// i, or i - 1 in the lower half (the all ones mask is -1)
+	__m128i base = _mm_add_epi32(i, _mm_andnot_si128(isUpperHalf, _mm_set1_epi32(-1)));
+	texel0 = _mm_or_si128(_mm_andnot_si128(isWrapped, base),
+		_mm_and_si128(isWrapped, _mm_set1_epi32((int)size - 2)));
+	texel1 = _mm_add_epi32(texel0, _mm_set1_epi32(1));
+	weight = _mm_add_epi32(_mm_sub_epi32(f, _mm_and_si128(isUpperHalf, halfTexel)),
+		_mm_and_si128(isWrapped, halfTexel));
+}
+#endif
+
+void Texture::sampleLevelBilinearFixedSpan(const LevelView &level,
+	const float *floatS, const float *floatT, int n, unsigned int *colors) const
+{
+	int i = 0;
+#if TEXTURE_USE_SSE
+	// texel fetch for lanes the gather can't do
+	auto fetchTexel = [&level](int s, int t) {
+		unsigned int texel;
+		memcpy(&texel, level.texels + getTexelOffset(level, s, t), 4);
+		return (int)texel;
+	};
+	// single texel levels wrap onto themselves, the scalar path does that
+	if (level.width >= 2 && level.height >= 2) {
+		const __m128i lastT = _mm_set1_epi32((int)level.height - 1);
+		int s0[4], s1[4], t0[4], t1[4];
+		for (; i + 4 <= n; i += 4) {
+			__m128i texelS0, texelS1, texelT0, texelT1, weightS, weightT;
+			getTileTexelPairQuad(_mm_loadu_ps(floatS + i), level.width, texelS0, texelS1, weightS);
+			getTileTexelPairQuad(_mm_loadu_ps(floatT + i), level.height, texelT0, texelT1, weightT);
+			_mm_storeu_si128((__m128i *)s0, texelS0);
+			_mm_storeu_si128((__m128i *)s1, texelS1);
+			// t needs to be inverted
+			_mm_storeu_si128((__m128i *)t0, _mm_sub_epi32(lastT, texelT0));
+			_mm_storeu_si128((__m128i *)t1, _mm_sub_epi32(lastT, texelT1));
+
+			__m128i c00, c10, c01, c11;
+#if defined(__AVX2__)
+			if (level.tilesPerRow == 0) {
+				const __m128i width = _mm_set1_epi32((int)level.width);
+				__m128i row0 = _mm_mullo_epi32(_mm_loadu_si128((const __m128i *)t0), width);
+				__m128i row1 = _mm_mullo_epi32(_mm_loadu_si128((const __m128i *)t1), width);
+				__m128i col0 = _mm_loadu_si128((const __m128i *)s0);
+				__m128i col1 = _mm_loadu_si128((const __m128i *)s1);
+				const int *texels32 = (const int *)level.texels;
+				c00 = _mm_i32gather_epi32(texels32, _mm_add_epi32(row0, col0), 4);
+				c10 = _mm_i32gather_epi32(texels32, _mm_add_epi32(row0, col1), 4);
+				c01 = _mm_i32gather_epi32(texels32, _mm_add_epi32(row1, col0), 4);
+				c11 = _mm_i32gather_epi32(texels32, _mm_add_epi32(row1, col1), 4);
+			}
+			else
+#endif
+			{
+				// SSE2 has no gather, fetch the 16 texels one by one
+				c00 = _mm_setr_epi32(fetchTexel(s0[0], t0[0]), fetchTexel(s0[1], t0[1]),
+					fetchTexel(s0[2], t0[2]), fetchTexel(s0[3], t0[3]));
+				c10 = _mm_setr_epi32(fetchTexel(s1[0], t0[0]), fetchTexel(s1[1], t0[1]),
+					fetchTexel(s1[2], t0[2]), fetchTexel(s1[3], t0[3]));
+				c01 = _mm_setr_epi32(fetchTexel(s0[0], t1[0]), fetchTexel(s0[1], t1[1]),
+					fetchTexel(s0[2], t1[2]), fetchTexel(s0[3], t1[3]));
+				c11 = _mm_setr_epi32(fetchTexel(s1[0], t1[0]), fetchTexel(s1[1], t1[1]),
+					fetchTexel(s1[2], t1[2]), fetchTexel(s1[3], t1[3]));
+			}
+			_mm_storeu_si128((__m128i *)(colors + i), lerpPackedQuad(
+				lerpPackedQuad(c00, c10, weightS),
+				lerpPackedQuad(c01, c11, weightS),
+				weightT));
+		}
+	}
+#endif
+	for (; i < n; i++)
+		colors[i] = sampleLevelBilinearFixed(level, floatS[i], floatT[i], false);
+}
+
+void Texture::sampleTexBilinearTileSpan(const float *floatS, const float *floatT, int n,
+	unsigned int *colors) const
+{
+	if (!isFixedPointFilteringOn) {
+		for (int i = 0; i < n; i++)
+			colors[i] = sampleTexBilinearTile(floatS[i], floatT[i]);
+		return;
+	}
+	sampleLevelBilinearFixedSpan(getLevelView(0), floatS, floatT, n, colors);
+}
+
+void Texture::sampleTexTrilinearTileSpan(const float *floatS, const float *floatT, float lod, int n,
+	unsigned int *colors) const
+{
+	if (lod <= 0.0f || image->mips.empty()) {
+		sampleTexBilinearTileSpan(floatS, floatT, n, colors);
+		return;
+	}
+	if (!isFixedPointFilteringOn) {
+		for (int i = 0; i < n; i++)
+			colors[i] = sampleTexTrilinearTile(floatS[i], floatT[i], lod);
+		return;
+	}
+
+	int level0 = (int)lod;
+	if (level0 >= (int)image->mips.size()) {
+		// coarsest level, nothing to blend with
+		sampleLevelBilinearFixedSpan(getLevelView((int)image->mips.size()), floatS, floatT, n, colors);
+		return;
+	}
+	LevelView finer = getLevelView(level0), coarser = getLevelView(level0 + 1);
+	unsigned int weight = (unsigned int)((lod - (float)level0) * 256.0f);
+	// the coarser level goes through a small buffer, a chunk at a time
+	const int chunkSize = 64;
+	unsigned int coarserColors[chunkSize];
+	for (int begin = 0; begin < n; begin += chunkSize) {
+		int chunkN = min(chunkSize, n - begin);
+		sampleLevelBilinearFixedSpan(finer, floatS + begin, floatT + begin, chunkN, colors + begin);
+		sampleLevelBilinearFixedSpan(coarser, floatS + begin, floatT + begin, chunkN, coarserColors);
+		for (int i = 0; i < chunkN; i++)
+			colors[begin + i] = lerpPacked(colors[begin + i], coarserColors[i], weight);
+	}
+}
+
 void Texture::flipAboutX(void)
 {
+	// image may be shared, flip a private copy of it
+	shared_ptr<TexelImage> flipped = std::make_shared<TexelImage>();
+	flipped->texels = image->texels;
+	flipped->width = texWidth;
+	flipped->height = texHeight;
+	vector<unsigned char> &texels = flipped->texels;
+
 	unsigned int texelIndexI, texelIndexK;
 	unsigned int i, k;
 
@@ -258,10 +840,19 @@ void Texture::flipAboutX(void)
 			}
 		}
 	}
+	buildMipChain(*flipped);
+	setImage(flipped, "");
 }
 
 void Texture::flipAboutY(void)
 {
+	// image may be shared, flip a private copy of it
+	shared_ptr<TexelImage> flipped = std::make_shared<TexelImage>();
+	flipped->texels = image->texels;
+	flipped->width = texWidth;
+	flipped->height = texHeight;
+	vector<unsigned char> &texels = flipped->texels;
+
 	unsigned int texelIndexI, texelIndexK;
 	unsigned int i, k;
 
@@ -286,4 +877,6 @@ void Texture::flipAboutY(void)
 			}
 		}
 	}
+	buildMipChain(*flipped);
+	setImage(flipped, "");
 }
@@ -3,20 +3,112 @@
 using std::string;
 #include <vector>
 using std::vector;
+#include <memory>
+using std::shared_ptr;
+class V3;
 
 // Implements a texture class for texturing operations
 class Texture {
 
+public:
+	// one RGBA8 row major image level
+	struct MipLevel {
+		vector<unsigned char> texels;
+		unsigned int width, height;
+	};
+	// decoded image (texels) plus its mip chain below the base level:
+	// mips[0] is half the size of the base level, each next one half of the
+	// previous, down to 1x1. Immutable once built, so Texture instances can
+	// share one copy through TextureRegistry. Changing a texture (flips)
+	// builds a new image instead.
+	struct TexelImage {
+		vector<unsigned char> texels;
+		unsigned int width, height;
+		vector<MipLevel> mips;
+		// texels of all levels
+		size_t getSizeInBytes(void) const;
+	};
+
 private:
-	vector<unsigned char> texels;
-	unsigned int texWidth, texHeight;
+	shared_ptr<const TexelImage> image; // never null, empty if loading failed
+	unsigned int texWidth, texHeight; // same as image's
+	// key image is registered under in TextureRegistry. Empty if it is
+	// private to this texture
+	string registryKey;
 
-	void loadPngTexture(const string &filename);
+public:
+	// memory layout the SW samplers read texels from. ROW_MAJOR is the
+	// plain RGBARGBA... image. TILED stores K_TEXEL_TILE_SIZE squared texel
+	// tiles one after the other (64 bytes, one cache line) with Morton order
+	// inside a tile, so a bilinear footprint mostly hits one cache line no
+	// matter which direction the rasterizer walks the texture. texels (and
+	// getTexels*) always stay row major for HW upload, the tiled copies are
+	// kept next to them.
+	enum class TexelLayout { ROW_MAJOR, TILED };
+	static const unsigned int K_TEXEL_TILE_SIZE = 4;
+private:
+	TexelLayout texelLayout;
+	// bilinear and trilinear lookups blend packed RGBA8 with 8.8 fixed
+	// point weights instead of going through V3 floats
+	bool isFixedPointFilteringOn;
+	// every level of image in TILED layout, base level first. Per texture
+	// since the layout is a per texture setting
+	vector<vector<unsigned char>> tiledLevels;
+
+	// what sampling needs to address one level in the current layout.
+	// tilesPerRow is 0 in ROW_MAJOR layout
+	struct LevelView {
+		const unsigned char *texels;
+		unsigned int width, height;
+		unsigned int tilesPerRow;
+	};
+	// level 0 is the base texture, level i > 0 is image->mips[i - 1]
+	LevelView getLevelView(int level) const;
+	// byte offset of texel (s, t) (t counted in stored rows) of a level
+	static inline unsigned int getTexelOffset(const LevelView &level,
+		unsigned int s, unsigned int t)
+	{
+		if (level.tilesPerRow == 0)
+			return (t * level.width + s) * 4;
+		// tile index, then Morton order of the 2 bit coordinates inside the tile
+		unsigned int tileIndex = (t / K_TEXEL_TILE_SIZE) * level.tilesPerRow + s / K_TEXEL_TILE_SIZE;
+		unsigned int inS = s % K_TEXEL_TILE_SIZE, inT = t % K_TEXEL_TILE_SIZE;
+		unsigned int inTile = (inS & 1) | ((inT & 1) << 1) | ((inS & 2) << 1) | ((inT & 2) << 2);
+		return (tileIndex * K_TEXEL_TILE_SIZE * K_TEXEL_TILE_SIZE + inTile) * 4;
+	}
+
+	// decodes a png file into image. False if that failed
+	static bool loadPngTexture(const string &filename, TexelImage &image);
+	// reads a binary texture cache file (see saveBinaryCache) into image.
+	// False if the file is missing or does not look right
+	static bool loadBinaryCache(const string &filename, TexelImage &image);
 	float clip(float n, float lower, float upper) const;
+	// 2x2 box filters each level from the one above it
+	static void buildMipChain(TexelImage &image);
+	// makes newImage the image of this texture
+	void setImage(const shared_ptr<const TexelImage> &newImage, const string &key);
+	// (re)builds the tiled copies of all levels, or frees them when the
+	// layout is ROW_MAJOR
+	void buildTiledTexels(void);
+	// bilinear lookup with tiling into one level
+	V3 sampleLevelBilinearTile(const LevelView &level, float s, float t) const;
+	// integer bilinear lookup into one level, keeps alpha. Tiles s,t with
+	// the same texel addressing as sampleLevelBilinearTile, or clamps them
+	// to the texture when isClamped
+	unsigned int sampleLevelBilinearFixed(const LevelView &level,
+		float s, float t, bool isClamped) const;
+	// sampleLevelBilinearFixed (tiling) of n s,t pairs, 4 at a time with SSE
+	void sampleLevelBilinearFixedSpan(const LevelView &level,
+		const float *s, const float *t, int n, unsigned int *colors) const;
 public:
+	// png files are decoded once per process, every other texture of
+	// the same file shares the texels (see TextureRegistry). If the png
+	// has a binary cache file (getBinaryCachePath) newer than itself that
+	// gets loaded instead, which skips decoding and mip building
 	Texture(const string &filename);
 	// constructs a texture out of a sub section of 
-	// another texture. Useful for building env maps.
+	// another texture. Useful for building env maps. Sub sections of
+	// registered textures get registered too.
 	Texture(const Texture &otherTexture, 
 		unsigned int beginS, unsigned int endS,
 		unsigned int beginT, unsigned int endT);
@@ -24,19 +116,58 @@ public:
 
 	unsigned int getTexWidth(void) const { return texWidth; }
 	unsigned int getTexHeight(void) const { return texHeight; }
-	vector<unsigned char> getTexels(void) const { return texels; }
-	vector<unsigned char>& getTexelsRef(void) { return texels; }
-	vector<unsigned char>* getTexelsPtr(void) { return &texels; }
+	vector<unsigned char> getTexels(void) const { return image->texels; }
+	// texels may be shared with other textures, so these are read only
+	const vector<unsigned char>& getTexelsRef(void) const { return image->texels; }
+	const vector<unsigned char>* getTexelsPtr(void) const { return &image->texels; }
+	const string &getRegistryKey(void) const { return registryKey; }
+
+	// binary texture cache: a small header (magic, version, format, size,
+	// levels) followed by the raw RGBA8 texels of every mip level, so
+	// loading is one read per level. The png stays the source of truth,
+	// tools/texbake writes these next to it
+	static const unsigned int K_BINARY_CACHE_VERSION = 1;
+	static string getBinaryCachePath(const string &pngFilename) { return pngFilename + ".btex"; }
+	// writes image and its mip chain to filename. False if that failed
+	bool saveBinaryCache(const string &filename) const;
 
 	// supports alpha texture
 	unsigned int sampleTexNearClamp(float s, float t) const;
 	// supports alpha texture
 	unsigned int sampleTexNearTile(float s, float t) const;
 	// does not support alpha texture due to use of V3 to 
-	// do vector interpolation (alpha the 4 component gets lost)
+	// do vector interpolation (alpha the 4 component gets lost),
+	// unless fixed point filtering is on
 	unsigned int sampleTexBilinearTile(float s, float t) const;
-	// flips image upside down
+	// supports alpha texture, always uses fixed point filtering
+	unsigned int sampleTexBilinearClamp(float s, float t) const;
+	// number of levels including the base one
+	int getMipLevelsN(void) const { return 1 + (int)image->mips.size(); }
+	// level of detail for a pixel given the screen space derivatives of s
+	// and t along u and v. 0 means one texel per pixel (or magnification),
+	// every +1 means the pixel covers twice as many texels across
+	float computeLod(float dsdu, float dtdu, float dsdv, float dtdv) const;
+	// trilinear lookup: bilinear in the two mip levels around lod and lerp
+	// between them. Same as sampleTexBilinearTile for lod <= 0. Alpha only
+	// with fixed point filtering
+	unsigned int sampleTexTrilinearTile(float s, float t, float lod) const;
+	// span versions of the two above: sample n s,t pairs at once and write
+	// n packed colors. Trilinear uses one lod for the whole span, like GPUs
+	// do for a quad of pixels, so the textured rasterizer passes the covered
+	// pixels of one quad per call. Only fixed point filtering is vectorized,
+	// the float path samples one pair at a time
+	void sampleTexBilinearTileSpan(const float *s, const float *t, int n,
+		unsigned int *colors) const;
+	void sampleTexTrilinearTileSpan(const float *s, const float *t, float lod, int n,
+		unsigned int *colors) const;
+	// off by default: the float path stays the reference
+	void setIsFixedPointFilteringOn(bool value) { isFixedPointFilteringOn = value; }
+	bool getIsFixedPointFilteringOn(void) const { return isFixedPointFilteringOn; }
+	// switches the layout the samplers use. Textures start out ROW_MAJOR
+	void setTexelLayout(TexelLayout layout);
+	TexelLayout getTexelLayout(void) const { return texelLayout; }
+	// flips image upside down. The texture gets its own copy of the image
 	void flipAboutX(void);
-	// flips image left to right
+	// flips image left to right. The texture gets its own copy of the image
 	void flipAboutY(void);
 };
\ No newline at end of file
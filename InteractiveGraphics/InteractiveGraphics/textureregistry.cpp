@@ -0,0 +1,82 @@
+#include "textureregistry.h"
+#include <iostream>
+using std::cerr;
+using std::endl;
+
+TextureRegistry &TextureRegistry::getInstance(void)
+{
+	// constructed on first use, so textures in static objects (e.g. the
+	// scene's static CubeMaps) can use it
+	static TextureRegistry registry;
+	return registry;
+}
+
+shared_ptr<const Texture::TexelImage> TextureRegistry::acquire(const string &key,
+	const std::function<shared_ptr<Texture::TexelImage>(void)> &build)
+{
+	TextureRegistry &registry = getInstance();
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		auto it = registry.images.find(key);
+		if (it != registry.images.end()) {
+			registry.hitsN++;
+			return it->second;
+		}
+		registry.missesN++;
+	}
+
+	// decoding can take a while, don't hold up other threads
+	shared_ptr<const Texture::TexelImage> image = build();
+	if (!image)
+		return image;
+
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	// if another thread registered the same key meanwhile use its image
+	auto inserted = registry.images.insert(std::make_pair(key, image));
+	return inserted.first->second;
+}
+
+size_t TextureRegistry::purgeUnused(void)
+{
+	TextureRegistry &registry = getInstance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	size_t bytesFreed = 0;
+	for (auto it = registry.images.begin(); it != registry.images.end();) {
+		// the registry holds the only reference
+		if (it->second.use_count() == 1) {
+			bytesFreed += it->second->getSizeInBytes();
+			it = registry.images.erase(it);
+		}
+		else
+			++it;
+	}
+	return bytesFreed;
+}
+
+TextureRegistry::Stats TextureRegistry::getStats(void)
+{
+	TextureRegistry &registry = getInstance();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	Stats stats = {};
+	stats.hitsN = registry.hitsN;
+	stats.missesN = registry.missesN;
+	for (const auto &entry : registry.images) {
+		long usersN = entry.second.use_count() - 1; // minus the registry itself
+		size_t bytes = entry.second->getSizeInBytes();
+		stats.imagesN++;
+		stats.bytes += bytes;
+		if (usersN > 0)
+			stats.imagesInUseN++;
+		if (usersN > 1)
+			stats.bytesShared += bytes * (size_t)(usersN - 1);
+	}
+	return stats;
+}
+
+void TextureRegistry::printStats(void)
+{
+	Stats stats = getStats();
+	cerr << "INFO: texture registry: " << stats.hitsN << " hits, " << stats.missesN << " misses, "
+		<< stats.imagesN << " images (" << stats.imagesInUseN << " in use), "
+		<< stats.bytes / 1024 << " KB, " << stats.bytesShared / 1024 << " KB saved by sharing" << endl;
+}
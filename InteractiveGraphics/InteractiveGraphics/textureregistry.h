@@ -0,0 +1,48 @@
+#pragma once
+#include "texture.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+using std::string;
+using std::shared_ptr;
+
+// Process wide cache of decoded texture images. Texture asks it for the
+// image of a png file (key is the file path) or of a sub section of a
+// registered image (key is the path plus the section), and only builds
+// the image on a miss. Images are immutable so any number of Texture
+// instances share one copy. The registry keeps its own reference, so
+// images survive Scene::cleanForNewScene() and the next demo using the
+// same file doesn't decode it again. purgeUnused() gives that memory back.
+class TextureRegistry {
+public:
+	struct Stats {
+		unsigned int hitsN; // acquire() calls answered from the cache
+		unsigned int missesN; // acquire() calls that had to build the image
+		unsigned int imagesN; // images currently registered
+		unsigned int imagesInUseN; // of those, the ones a Texture still uses
+		size_t bytes; // texels of all registered images, mips included
+		// texels that would exist in addition if every Texture had its own copy
+		size_t bytesShared;
+	};
+
+	// returns the image registered under key, or registers what build
+	// returns. build may return nullptr (e.g. file not found), which is
+	// passed on and not registered. Thread safe, build runs unlocked.
+	static shared_ptr<const Texture::TexelImage> acquire(const string &key,
+		const std::function<shared_ptr<Texture::TexelImage>(void)> &build);
+	// forgets images no Texture uses anymore, returns the bytes freed
+	static size_t purgeUnused(void);
+	static Stats getStats(void);
+	// prints getStats() as INFO
+	static void printStats(void);
+
+private:
+	std::mutex mutex;
+	std::map<string, shared_ptr<const Texture::TexelImage>> images;
+	unsigned int hitsN = 0, missesN = 0;
+
+	TextureRegistry() {}
+	static TextureRegistry &getInstance(void);
+};
@@ -4,36 +4,106 @@ using std::endl;
 using std::ios;
 #include <fstream>
 using std::ifstream;
+using std::ofstream;
+#include <memory>
+#include <algorithm>
+using std::min;
+using std::max;
+#include <atomic>
+#include <xmmintrin.h> // _mm_malloc
+#ifndef SW_HEADLESS
 #include <GL\glew.h>
-#include "TMesh.h"
+#endif
+#include "tmesh.h"
+#include "sw_depthtarget.h"
+#include "mappedfile.h"
+#include <cstring>
+
+// memory mapped meshes use the bin file's xyz triplets as V3s in place
+static_assert(sizeof(V3) == 3 * sizeof(float), "V3 has to be three packed floats");
 const float epsilonMinArea = 0.1f;
 
+// source of TMesh::vertsStamp values, atomic so meshes can be built on
+// any thread
+static unsigned int getNewVertsStamp(void)
+{
+	static std::atomic<unsigned int> lastVertsStamp(0);
+	return ++lastVertsStamp;
+}
+
+// true if the box is entirely outside one of the frustum planes (see
+// PPC::getFrustumPlanes) of a camera with eye point eye
+static bool isBoxOutsideFrustum(const V3 &minCorner, const V3 &maxCorner,
+	const V3 *planeNormals, const V3 &eye)
+{
+	for (int pi = 0; pi < PPC::K_FRUSTUM_PLANES_N; pi++) {
+		// box corner furthest along the plane normal, if even that one is
+		// outside then the whole box is
+		V3 farCorner(
+			(planeNormals[pi][0] >= 0.0f) ? maxCorner[0] : minCorner[0],
+			(planeNormals[pi][1] >= 0.0f) ? maxCorner[1] : minCorner[1],
+			(planeNormals[pi][2] >= 0.0f) ? maxCorner[2] : minCorner[2]);
+		if ((farCorner - eye) * planeNormals[pi] < 0.0f)
+			return true;
+	}
+	return false;
+}
+
+// true if the projected triangle is entirely off one side of a w x h image
+static inline bool isProjTriangleOffImage(const V3 &p0, const V3 &p1, const V3 &p2,
+	float w, float h)
+{
+	// all vertices are in front of the camera by now so the side planes
+	// of the frustum are just the image borders
+	return (p0[0] < 0.0f && p1[0] < 0.0f && p2[0] < 0.0f) ||
+		(p0[0] > w && p1[0] > w && p2[0] > w) ||
+		(p0[1] < 0.0f && p1[1] < 0.0f && p2[1] < 0.0f) ||
+		(p0[1] > h && p1[1] > h && p2[1] > h);
+}
+
 TMesh::TMesh():	
-	vertsN(0),
-	trisN(0),
 	verts(nullptr),
 	projVerts(nullptr),
 	isVertProjVis(nullptr),
+	vertsX(nullptr),
+	vertsY(nullptr),
+	vertsZ(nullptr),
+	soaVertsCapacity(0),
+	isSoAVertsDirty(true),
+	isSoAVertsMapped(false),
+	vertsStamp(getNewVertsStamp()),
 	cols(nullptr),
-	tcs(nullptr),
 	normals(nullptr),
+	tcs(nullptr),
+	vertsN(0),
 	tris(nullptr),
+	trisN(0),
 	aabb(nullptr),
+	mappedFile(nullptr),
+	meshlets(nullptr),
+	meshletsN(0),
+	meshletsVertsStamp(0),
+	isHwSupportEnabled(false),
 	indexBuffer(0),
 	vao(0),
-	isHwSupportEnabled(false)
+	triSetups(nullptr),
+	setupPPC(nullptr),
+	projGeneration(1),
+	isBackFaceCullingOn(false)
 {
-
+	resetCullStats();
 }
 
-TMesh::TMesh(const char * fname)
+TMesh::TMesh(const char * fname, bool isMemoryMapped) :
+	TMesh()
 {
-	loadBin(fname);
+	loadBin(fname, isMemoryMapped);
 }
 
 TMesh::~TMesh()
 {
 	cleanUp();
+#ifndef SW_HEADLESS
 	if (isHwSupportEnabled) {
 		glDeleteVertexArrays(1, &vao);
 		glDeleteBuffers(1, &vertexBuffer[0]);
@@ -41,18 +111,59 @@ TMesh::~TMesh()
 		// replace with glDeleteBuffers(4, vertexBuffer) when using the 4 slots
 		glDeleteBuffers(1, &indexBuffer);
 	}
+#endif
 }
 
 void TMesh::cleanUp(void)
 {
+	if (mappedFile) {
+		// attribute arrays live in the mapping, nothing to delete
+		verts = nullptr;
+		cols = nullptr;
+		normals = nullptr;
+		tcs = nullptr;
+		tris = nullptr;
+		if (isSoAVertsMapped) {
+			vertsX = nullptr;
+			vertsY = nullptr;
+			vertsZ = nullptr;
+			soaVertsCapacity = 0;
+			isSoAVertsMapped = false;
+		}
+		meshlets = nullptr;
+		meshletsN = 0;
+		delete mappedFile;
+		mappedFile = nullptr;
+	}
 	if (verts) {
 		delete[] verts;
+		verts = nullptr;
+	}
+	if (projVerts) {
 		delete[] projVerts;
 		delete[] isVertProjVis;
-		verts = nullptr;
 		projVerts = nullptr;
 		isVertProjVis = nullptr;
 	}
+	if (vertsX) {
+		_mm_free(vertsX);
+		_mm_free(vertsY);
+		_mm_free(vertsZ);
+		vertsX = nullptr;
+		vertsY = nullptr;
+		vertsZ = nullptr;
+		soaVertsCapacity = 0;
+	}
+	isSoAVertsDirty = true;
+	vertsStamp = getNewVertsStamp();
+	if (triSetups) {
+		delete[] triSetups;
+		triSetups = nullptr;
+	}
+	if (setupPPC) {
+		delete setupPPC;
+		setupPPC = nullptr;
+	}
 	if (cols) {
 		delete[] cols;
 		cols = nullptr;
@@ -115,8 +226,6 @@ void TMesh::createTetrahedronTestMesh(void)
 	vertsN = 4;
 	// allocate vertices array
 	verts = new V3[vertsN];
-	projVerts = new V3[vertsN];
-	isVertProjVis = new bool[vertsN];
 	// allocate colors array
 	cols = new V3[vertsN];
 
@@ -166,8 +275,6 @@ void TMesh::createQuadTMesh(bool isTiling)
 	vertsN = 4;
 	// allocate vertices array
 	verts = new V3[vertsN];
-	projVerts = new V3[vertsN];
-	isVertProjVis = new bool[vertsN];
 	// allocate colors array
 	cols = new V3[vertsN];
 	// allocate tex coords array
@@ -227,8 +334,6 @@ void TMesh::createQuadTMesh(const V3 &p1,
 	vertsN = 4;
 	// allocate vertices array
 	verts = new V3[vertsN];
-	projVerts = new V3[vertsN];
-	isVertProjVis = new bool[vertsN];
 	// allocate colors array
 	cols = new V3[vertsN];
 	// allocate tex coords array
@@ -292,11 +397,16 @@ void TMesh::createQuadTMesh(const V3 &p1,
 	aabb = new AABB(computeAABB());
 }
 
-void TMesh::loadBin(const char * fname)
+void TMesh::loadBin(const char * fname, bool isMemoryMapped)
 {
 	// clean in case it had other stuff already loaded
 	this->cleanUp();
 
+	if (isMemoryMapped) {
+		mapBin(fname);
+		return;
+	}
+
 	ifstream ifs(fname, ios::binary);
 	if (ifs.fail()) {
 		cerr << "INFO: cannot open triangle mesh bin file: " << fname << endl;
@@ -313,8 +423,6 @@ void TMesh::loadBin(const char * fname)
 	}
 	// allocate space for the vertex data
 	verts = new V3[vertsN];
-	projVerts = new V3[vertsN];
-	isVertProjVis = new bool[vertsN];
 
 	// reads whether or not there is color info in the file
 	ifs.read(&yn, 1); // cols 3 floats
@@ -361,8 +469,488 @@ void TMesh::loadBin(const char * fname)
 	aabb = new AABB(computeAABB());
 }
 
+void TMesh::mapBin(const char * fname)
+{
+	mappedFile = new MappedFile();
+	if (!mappedFile->open(fname)) {
+		cerr << "INFO: cannot open triangle mesh bin file: " << fname << endl;
+		cleanUp();
+		return;
+	}
+	unsigned char *data = mappedFile->getData();
+	size_t size = mappedFile->getSize();
+
+	// same layout loadBin reads: vertsN, four y/n flags (xyz, rgb, normals,
+	// tcs), the vertex arrays, trisN, the triangles. Everything is 4 byte
+	// aligned, so the arrays can be used right where they are
+	size_t offset = sizeof(int) + 4;
+	if (size < offset) {
+		cerr << "ERROR: truncated triangle mesh bin file: " << fname << endl;
+		cleanUp();
+		return;
+	}
+	memcpy(&vertsN, data, sizeof(int));
+	const char *yns = (const char*)data + sizeof(int);
+	if (yns[0] != 'y' || vertsN < 0) {
+		cerr << "INTERNAL ERROR: there should always be vertex xyz data" << endl;
+		cleanUp();
+		return;
+	}
+	size_t vertsFloatsN = (size_t)vertsN * (3 + ((yns[1] == 'y') ? 3 : 0) +
+		((yns[2] == 'y') ? 3 : 0) + ((yns[3] == 'y') ? 2 : 0));
+	if (size < offset + vertsFloatsN * sizeof(float) + sizeof(int)) {
+		cerr << "ERROR: truncated triangle mesh bin file: " << fname << endl;
+		cleanUp();
+		return;
+	}
+
+	verts = (V3*)(data + offset);
+	offset += (size_t)vertsN * sizeof(V3);
+	if (yns[1] == 'y') {
+		cols = (V3*)(data + offset);
+		offset += (size_t)vertsN * sizeof(V3);
+	}
+	if (yns[2] == 'y') {
+		normals = (V3*)(data + offset);
+		offset += (size_t)vertsN * sizeof(V3);
+	}
+	if (yns[3] == 'y') {
+		tcs = (float*)(data + offset);
+		offset += (size_t)vertsN * 2 * sizeof(float);
+	}
+
+	memcpy(&trisN, data + offset, sizeof(int));
+	offset += sizeof(int);
+	if (trisN < 0 || size < offset + (size_t)trisN * 3 * sizeof(unsigned int)) {
+		cerr << "ERROR: truncated triangle mesh bin file: " << fname << endl;
+		cleanUp();
+		return;
+	}
+	tris = (unsigned int*)(data + offset);
+
+	cerr << "INFO: mapped " << vertsN << " verts, " << trisN << " tris from " << endl << "      " << fname << endl;
+	cerr << "      xyz " << ((cols) ? "rgb " : "") << ((normals) ? "nxnynz " : "") << ((tcs) ? "tcstct " : "") << endl;
+
+	// recompute AABB
+	aabb = new AABB(computeAABB());
+}
+
+// chunked mesh file header, the chunk table follows it
+struct ChunkedMeshHeader {
+	char magic[4]; // "IMSH"
+	unsigned int version; // K_CHUNKED_MESH_VERSION
+	int vertsN, trisN;
+	float aabbMin[3], aabbMax[3];
+	unsigned int chunksN;
+	unsigned int reserved; // keeps the table 8 byte aligned
+};
+
+struct ChunkedMeshChunk {
+	char id[4];
+	unsigned int elementsN; // vertices, triangles or meshlets
+	unsigned long long offset; // from the start of the file, 32 byte aligned
+	unsigned long long size; // in bytes
+};
+
+// chunk data is aligned for full width vector loads (see K_SOA_PADDING)
+static const size_t K_CHUNK_ALIGNMENT = 32;
+
+string TMesh::getChunkedPath(const string & binFilename)
+{
+	size_t dotPos = binFilename.rfind('.');
+	size_t slashPos = binFilename.find_last_of("/\\");
+	if (dotPos == string::npos || (slashPos != string::npos && dotPos < slashPos))
+		return binFilename + ".cmesh";
+	return binFilename.substr(0, dotPos) + ".cmesh";
+}
+
+vector<TMesh::Meshlet> TMesh::buildMeshlets(void) const
+{
+	vector<Meshlet> ret;
+	vector<int> vertMeshlet(vertsN, -1); // last meshlet that used each vertex
+	Meshlet meshlet = {};
+	int meshletVertsN = 0;
+	for (int tri = 0; tri < trisN; tri++) {
+		int newVertsN = 0;
+		for (int k = 0; k < 3; k++)
+			newVertsN += (vertMeshlet[tris[3 * tri + k]] != (int)ret.size()) ? 1 : 0;
+		// start a new meshlet when this triangle doesn't fit
+		if (meshlet.trisN == K_MESHLET_MAX_TRIS || meshletVertsN + newVertsN > K_MESHLET_MAX_VERTS) {
+			ret.push_back(meshlet);
+			meshlet = {};
+			meshlet.firstTri = tri;
+			meshletVertsN = 0;
+		}
+		for (int k = 0; k < 3; k++) {
+			unsigned int vi = tris[3 * tri + k];
+			if (meshlet.trisN == 0 && k == 0) {
+				for (int j = 0; j < 3; j++)
+					meshlet.aabbMin[j] = meshlet.aabbMax[j] = verts[vi][j];
+			}
+			if (vertMeshlet[vi] != (int)ret.size()) {
+				vertMeshlet[vi] = (int)ret.size();
+				meshletVertsN++;
+			}
+			for (int j = 0; j < 3; j++) {
+				meshlet.aabbMin[j] = min(meshlet.aabbMin[j], verts[vi][j]);
+				meshlet.aabbMax[j] = max(meshlet.aabbMax[j], verts[vi][j]);
+			}
+		}
+		meshlet.trisN++;
+	}
+	if (meshlet.trisN > 0)
+		ret.push_back(meshlet);
+	return ret;
+}
 
-void TMesh::drawWireframe(SWFrameBuffer &fb, const PPC &ppc) {
+void TMesh::reorderVerticesByFirstUse(void)
+{
+	vector<int> newIndices(vertsN, -1);
+	int nextIndex = 0;
+	for (int i = 0; i < trisN * 3; i++) {
+		if (newIndices[tris[i]] < 0)
+			newIndices[tris[i]] = nextIndex++;
+	}
+	// vertices no triangle uses go last
+	for (int vi = 0; vi < vertsN; vi++) {
+		if (newIndices[vi] < 0)
+			newIndices[vi] = nextIndex++;
+	}
+
+	vector<V3> tmp(vertsN);
+	V3 *v3Arrays[3] = { verts, cols, normals };
+	for (V3 *v3Array : v3Arrays) {
+		if (v3Array == nullptr)
+			continue;
+		for (int vi = 0; vi < vertsN; vi++)
+			tmp[newIndices[vi]] = v3Array[vi];
+		std::copy(tmp.begin(), tmp.end(), v3Array);
+	}
+	if (tcs) {
+		vector<float> tmpTcs(vertsN * 2);
+		for (int vi = 0; vi < vertsN; vi++) {
+			tmpTcs[newIndices[vi] * 2 + 0] = tcs[vi * 2 + 0];
+			tmpTcs[newIndices[vi] * 2 + 1] = tcs[vi * 2 + 1];
+		}
+		std::copy(tmpTcs.begin(), tmpTcs.end(), tcs);
+	}
+	for (int i = 0; i < trisN * 3; i++)
+		tris[i] = (unsigned int)newIndices[tris[i]];
+
+	isSoAVertsDirty = true;
+	vertsStamp = getNewVertsStamp();
+}
+
+float TMesh::computeACMR(int cacheSize) const
+{
+	if (trisN < 1)
+		return 0.0f;
+	vector<int> cacheTime(vertsN, -cacheSize - 1); // when each vertex went in
+	int time = 0, missesN = 0;
+	for (int i = 0; i < trisN * 3; i++) {
+		unsigned int vi = tris[i];
+		// FIFO: hits don't refresh, only misses push vertices in
+		if (time - cacheTime[vi] > cacheSize) {
+			cacheTime[vi] = time++;
+			missesN++;
+		}
+	}
+	return (float)missesN / (float)trisN;
+}
+
+// vertex score of Forsyth's vertex cache optimization, see
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+static float getForsythVertexScore(int cachePosition, int activeTrisN)
+{
+	if (activeTrisN == 0)
+		return -1.0f; // nothing left to draw with this vertex
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) // used by the last triangle, no matter where
+			score = 0.75f;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (float)(TMesh::K_VERTEX_CACHE_SIZE - 3), 1.5f);
+	}
+	// vertices with few triangles left go first, so they don't get stranded
+	return score + 2.0f / sqrtf((float)activeTrisN);
+}
+
+void TMesh::optimizeTriangleOrder(void)
+{
+	if (trisN < 2)
+		return;
+
+	// triangles of each vertex, the ones not drawn yet come first
+	vector<int> vertTrisStart(vertsN + 1, 0);
+	for (int i = 0; i < trisN * 3; i++)
+		vertTrisStart[tris[i] + 1]++;
+	for (int vi = 0; vi < vertsN; vi++)
+		vertTrisStart[vi + 1] += vertTrisStart[vi];
+	vector<int> vertTris(trisN * 3);
+	vector<int> activeTrisN(vertsN, 0);
+	for (int tri = 0; tri < trisN; tri++) {
+		for (int k = 0; k < 3; k++) {
+			unsigned int vi = tris[3 * tri + k];
+			vertTris[vertTrisStart[vi] + activeTrisN[vi]++] = tri;
+		}
+	}
+
+	vector<int> cachePosition(vertsN, -1);
+	vector<float> vertScores(vertsN);
+	for (int vi = 0; vi < vertsN; vi++)
+		vertScores[vi] = getForsythVertexScore(-1, activeTrisN[vi]);
+	vector<float> triScores(trisN);
+	for (int tri = 0; tri < trisN; tri++)
+		triScores[tri] = vertScores[tris[3 * tri]] + vertScores[tris[3 * tri + 1]] + vertScores[tris[3 * tri + 2]];
+	vector<bool> isTriAdded(trisN, false);
+	vector<unsigned int> newTris(trisN * 3);
+
+	// LRU cache, most recent first, with room for the 3 vertices pushed in
+	// before the ones falling out are dropped
+	vector<int> cache, newCache;
+	cache.reserve(K_VERTEX_CACHE_SIZE + 3);
+	newCache.reserve(K_VERTEX_CACHE_SIZE + 3);
+
+	int bestTri = 0;
+	for (int t = 0, nextUnaddedTri = 0; t < trisN; t++) {
+		if (bestTri < 0) {
+			// nothing in the cache has triangles left, carry on in the
+			// original order
+			while (isTriAdded[nextUnaddedTri])
+				nextUnaddedTri++;
+			bestTri = nextUnaddedTri;
+		}
+		isTriAdded[bestTri] = true;
+		newCache.clear();
+		for (int k = 0; k < 3; k++) {
+			unsigned int vi = tris[3 * bestTri + k];
+			newTris[3 * t + k] = vi;
+			newCache.push_back(vi);
+			// move bestTri past the active ones of vi
+			int *vts = &vertTris[vertTrisStart[vi]];
+			int &activeN = activeTrisN[vi];
+			for (int j = 0; j < activeN; j++) {
+				if (vts[j] == bestTri) {
+					std::swap(vts[j], vts[activeN - 1]);
+					break;
+				}
+			}
+			activeN--;
+		}
+		for (int vi : cache) {
+			if (vi != newCache[0] && vi != newCache[1] && vi != newCache[2])
+				newCache.push_back(vi);
+		}
+		cache.swap(newCache);
+
+		// rescore whatever is or just was in the cache and the triangles
+		// they still have, the best of those goes next
+		bestTri = -1;
+		float bestScore = -1.0f;
+		for (int ci = 0; ci < (int)cache.size(); ci++) {
+			int vi = cache[ci];
+			cachePosition[vi] = (ci < K_VERTEX_CACHE_SIZE) ? ci : -1;
+			float scoreDelta = getForsythVertexScore(cachePosition[vi], activeTrisN[vi]) - vertScores[vi];
+			vertScores[vi] += scoreDelta;
+			for (int j = 0; j < activeTrisN[vi]; j++)
+				triScores[vertTris[vertTrisStart[vi] + j]] += scoreDelta;
+		}
+		for (int ci = 0; ci < min((int)cache.size(), K_VERTEX_CACHE_SIZE); ci++) {
+			int vi = cache[ci];
+			for (int j = 0; j < activeTrisN[vi]; j++) {
+				int tri = vertTris[vertTrisStart[vi] + j];
+				if (triScores[tri] > bestScore) {
+					bestScore = triScores[tri];
+					bestTri = tri;
+				}
+			}
+		}
+		if ((int)cache.size() > K_VERTEX_CACHE_SIZE)
+			cache.resize(K_VERTEX_CACHE_SIZE);
+	}
+	std::copy(newTris.begin(), newTris.end(), tris);
+
+	// triangles moved: reproject so per triangle setups get rebuilt, and
+	// the meshlet ranges are meaningless now
+	isSoAVertsDirty = true;
+	meshlets = nullptr;
+	meshletsN = 0;
+}
+
+void TMesh::optimizeVertexCache(void)
+{
+	float oldACMR = computeACMR();
+	optimizeTriangleOrder();
+	reorderVerticesByFirstUse();
+	cerr << "INFO: vertex cache ACMR " << oldACMR << " -> " << computeACMR() << " ("
+		<< vertsN << " verts, " << trisN << " tris, cache of " << K_VERTEX_CACHE_SIZE << ")" << endl;
+}
+
+bool TMesh::saveChunked(const string & filename) const
+{
+	if (vertsN == 0 || trisN < 1)
+		return false; // nothing loaded
+
+	// SoA positions are written padded, exactly like updateSoAVerts lays
+	// them out, so they can be used in place
+	int paddedVertsN = (vertsN + K_SOA_PADDING - 1) / K_SOA_PADDING * K_SOA_PADDING;
+	vector<float> soaVerts((size_t)paddedVertsN * 3, 0.0f);
+	for (int vi = 0; vi < vertsN; vi++) {
+		soaVerts[vi] = verts[vi][0];
+		soaVerts[paddedVertsN + vi] = verts[vi][1];
+		soaVerts[2 * paddedVertsN + vi] = verts[vi][2];
+	}
+	vector<Meshlet> newMeshlets = buildMeshlets();
+
+	struct ChunkData {
+		const char *id;
+		unsigned int elementsN;
+		const void *data;
+		size_t size;
+	};
+	vector<ChunkData> chunks;
+	chunks.push_back({ "VPOS", (unsigned int)vertsN, verts, vertsN * sizeof(V3) });
+	chunks.push_back({ "VSOA", (unsigned int)vertsN, soaVerts.data(), soaVerts.size() * sizeof(float) });
+	if (cols)
+		chunks.push_back({ "VCOL", (unsigned int)vertsN, cols, vertsN * sizeof(V3) });
+	if (normals)
+		chunks.push_back({ "VNRM", (unsigned int)vertsN, normals, vertsN * sizeof(V3) });
+	if (tcs)
+		chunks.push_back({ "VTCS", (unsigned int)vertsN, tcs, vertsN * 2 * sizeof(float) });
+	chunks.push_back({ "TRIS", (unsigned int)trisN, tris, trisN * 3 * sizeof(unsigned int) });
+	chunks.push_back({ "MLET", (unsigned int)newMeshlets.size(), newMeshlets.data(),
+		newMeshlets.size() * sizeof(Meshlet) });
+
+	ChunkedMeshHeader header = {};
+	memcpy(header.magic, "IMSH", 4);
+	header.version = K_CHUNKED_MESH_VERSION;
+	header.vertsN = vertsN;
+	header.trisN = trisN;
+	AABB box = computeAABB();
+	for (int j = 0; j < 3; j++) {
+		header.aabbMin[j] = box.getFristCorner()[j];
+		header.aabbMax[j] = box.getSecondCorner()[j];
+	}
+	header.chunksN = (unsigned int)chunks.size();
+
+	vector<ChunkedMeshChunk> table(chunks.size());
+	size_t offset = sizeof(header) + table.size() * sizeof(ChunkedMeshChunk);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		offset = (offset + K_CHUNK_ALIGNMENT - 1) / K_CHUNK_ALIGNMENT * K_CHUNK_ALIGNMENT;
+		memcpy(table[i].id, chunks[i].id, 4);
+		table[i].elementsN = chunks[i].elementsN;
+		table[i].offset = offset;
+		table[i].size = chunks[i].size;
+		offset += chunks[i].size;
+	}
+
+	ofstream ofs(filename, ios::binary);
+	if (ofs.fail()) {
+		cerr << "ERROR: cannot write chunked mesh file " << filename << endl;
+		return false;
+	}
+	ofs.write((const char *)&header, sizeof(header));
+	ofs.write((const char *)table.data(), table.size() * sizeof(ChunkedMeshChunk));
+	const char zeros[K_CHUNK_ALIGNMENT] = {};
+	size_t written = sizeof(header) + table.size() * sizeof(ChunkedMeshChunk);
+	for (size_t i = 0; i < chunks.size(); i++) {
+		ofs.write(zeros, (size_t)table[i].offset - written);
+		ofs.write((const char *)chunks[i].data, chunks[i].size);
+		written = (size_t)table[i].offset + chunks[i].size;
+	}
+	if (!ofs) {
+		cerr << "ERROR: failed writing chunked mesh file " << filename << endl;
+		return false;
+	}
+	return true;
+}
+
+bool TMesh::loadChunked(const char * fname)
+{
+	this->cleanUp();
+
+	mappedFile = new MappedFile();
+	if (!mappedFile->open(fname)) {
+		cerr << "INFO: cannot open chunked mesh file: " << fname << endl;
+		cleanUp();
+		return false;
+	}
+	unsigned char *data = mappedFile->getData();
+	size_t size = mappedFile->getSize();
+
+	ChunkedMeshHeader header;
+	if (size < sizeof(header)) {
+		cerr << "ERROR: bad chunked mesh file " << fname << endl;
+		cleanUp();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, "IMSH", 4) != 0 || header.version != K_CHUNKED_MESH_VERSION ||
+		header.vertsN < 1 || header.trisN < 1 ||
+		size < sizeof(header) + (size_t)header.chunksN * sizeof(ChunkedMeshChunk)) {
+		cerr << "ERROR: bad chunked mesh file " << fname << " (version " << header.version
+			<< ", expected " << K_CHUNKED_MESH_VERSION << ")" << endl;
+		cleanUp();
+		return false;
+	}
+	vertsN = header.vertsN;
+	trisN = header.trisN;
+	int paddedVertsN = (vertsN + K_SOA_PADDING - 1) / K_SOA_PADDING * K_SOA_PADDING;
+
+	// only the table is looked at here, chunk contents stay on disk
+	const ChunkedMeshChunk *table = (const ChunkedMeshChunk *)(data + sizeof(header));
+	for (unsigned int i = 0; i < header.chunksN; i++) {
+		const ChunkedMeshChunk &chunk = table[i];
+		if (chunk.offset % K_CHUNK_ALIGNMENT != 0 || chunk.offset > size || chunk.size > size - chunk.offset) {
+			cerr << "ERROR: bad chunk in chunked mesh file " << fname << endl;
+			cleanUp();
+			return false;
+		}
+		unsigned char *chunkData = data + chunk.offset;
+		// unknown chunks (newer optional data) are skipped
+		if (!memcmp(chunk.id, "VPOS", 4) && chunk.size == vertsN * sizeof(V3))
+			verts = (V3 *)chunkData;
+		else if (!memcmp(chunk.id, "VSOA", 4) && chunk.size == (size_t)paddedVertsN * 3 * sizeof(float)) {
+			vertsX = (float *)chunkData;
+			vertsY = vertsX + paddedVertsN;
+			vertsZ = vertsY + paddedVertsN;
+			soaVertsCapacity = paddedVertsN;
+			isSoAVertsMapped = true;
+		}
+		else if (!memcmp(chunk.id, "VCOL", 4) && chunk.size == vertsN * sizeof(V3))
+			cols = (V3 *)chunkData;
+		else if (!memcmp(chunk.id, "VNRM", 4) && chunk.size == vertsN * sizeof(V3))
+			normals = (V3 *)chunkData;
+		else if (!memcmp(chunk.id, "VTCS", 4) && chunk.size == vertsN * 2 * sizeof(float))
+			tcs = (float *)chunkData;
+		else if (!memcmp(chunk.id, "TRIS", 4) && chunk.size == trisN * 3 * sizeof(unsigned int))
+			tris = (unsigned int *)chunkData;
+		else if (!memcmp(chunk.id, "MLET", 4) && chunk.size == chunk.elementsN * sizeof(Meshlet)) {
+			meshlets = (const Meshlet *)chunkData;
+			meshletsN = (int)chunk.elementsN;
+		}
+	}
+	if (verts == nullptr || tris == nullptr) {
+		cerr << "ERROR: chunked mesh file " << fname << " has no vertices or triangles" << endl;
+		cleanUp();
+		return false;
+	}
+
+	// the SoA copy is already made (and the AABB known), so the first
+	// projection doesn't have to go through every vertex first
+	isSoAVertsDirty = !isSoAVertsMapped;
+	meshletsVertsStamp = vertsStamp;
+	aabb = new AABB(V3(header.aabbMin[0], header.aabbMin[1], header.aabbMin[2]));
+	aabb->AddPoint(V3(header.aabbMax[0], header.aabbMax[1], header.aabbMax[2]));
+
+	cerr << "INFO: mapped " << vertsN << " verts, " << trisN << " tris, " << meshletsN
+		<< " meshlets from " << endl << "      " << fname << endl;
+	cerr << "      xyz " << ((cols) ? "rgb " : "") << ((normals) ? "nxnynz " : "") << ((tcs) ? "tcstct " : "") << endl;
+	return true;
+}
+
+
+void TMesh::drawWireframe(SWRenderTarget &fb, const PPC &ppc) {
 
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -407,7 +995,7 @@ void TMesh::drawWireframe(SWFrameBuffer &fb, const PPC &ppc) {
 	}
 }
 
-void TMesh::drawVertexDots(SWFrameBuffer &fb, const PPC &ppc, float dotSize) {
+void TMesh::drawVertexDots(SWRenderTarget &fb, const PPC &ppc, float dotSize) {
 
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -426,7 +1014,7 @@ void TMesh::drawVertexDots(SWFrameBuffer &fb, const PPC &ppc, float dotSize) {
 	}
 }
 
-void TMesh::drawFilledFlat(SWFrameBuffer &fb, const PPC &ppc, unsigned int color)
+void TMesh::drawFilledFlat(SWRenderTarget &fb, const PPC &ppc, unsigned int color)
 {
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -438,6 +1026,10 @@ void TMesh::drawFilledFlat(SWFrameBuffer &fb, const PPC &ppc, unsigned int color
 	V3 tProjVerts[3];
 	bool isVisible;
 	
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -451,7 +1043,7 @@ void TMesh::drawFilledFlat(SWFrameBuffer &fb, const PPC &ppc, unsigned int color
 		isVisible &= isVertProjVis[tris[3 * tri + 1]];
 		isVisible &= isVertProjVis[tris[3 * tri + 2]];
 		
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -466,9 +1058,11 @@ void TMesh::drawFilledFlat(SWFrameBuffer &fb, const PPC &ppc, unsigned int color
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
-void TMesh::drawFilledFlatBarycentric(SWFrameBuffer &fb, const PPC &ppc) {
+void TMesh::drawFilledFlatBarycentric(SWRenderTarget &fb, const PPC &ppc) {
 
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -482,6 +1076,10 @@ void TMesh::drawFilledFlatBarycentric(SWFrameBuffer &fb, const PPC &ppc) {
 	V3 tProjVerts[3];
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -500,7 +1098,7 @@ void TMesh::drawFilledFlatBarycentric(SWFrameBuffer &fb, const PPC &ppc) {
 		currcols[1] = cols[tris[3 * tri + 1]];
 		currcols[2] = cols[tris[3 * tri + 2]];
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// The discriminat of the matrix used in screen space interpolation 
 			// is the area of the projected triangle. When that is 0, the matrix 
@@ -514,16 +1112,19 @@ void TMesh::drawFilledFlatBarycentric(SWFrameBuffer &fb, const PPC &ppc) {
 
 			if (projTriangleArea > epsilonMinArea) {
 
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
 				fb.draw2DFlatTriangleScreenSpace(
-					tProjVerts, currcols);
+					tProjVerts, currcols, setup);
 			}
 			else 
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
-void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
+void TMesh::drawFilledFlatPerspCorrect(SWRenderTarget & fb, const PPC & ppc)
 {
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -535,10 +1136,7 @@ void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 Q, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 Q;
 
 	// Draw filled triangles with color and depth linearly 
 	// interpolated in model space.
@@ -547,6 +1145,10 @@ void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
 	V3 tProjVerts[3];
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -570,7 +1172,7 @@ void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
 		currcols[1] = cols[tris[3 * tri + 1]];
 		currcols[2] = cols[tris[3 * tri + 2]];
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -580,11 +1182,7 @@ void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
 
 			if (projTriangleArea > epsilonMinArea) {
 
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				Q = VMinC * abc;
+				Q = getPerspCorrectMatQ(tri); // cached per view
 
 				fb.draw2DFlatTriangleModelSpace(
 					tProjVerts, currcols, Q);
@@ -593,9 +1191,11 @@ void TMesh::drawFilledFlatPerspCorrect(SWFrameBuffer & fb, const PPC & ppc)
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
-void TMesh::drawTextured(SWFrameBuffer & fb, const PPC & ppc, const Texture & texture)
+void TMesh::drawTextured(SWRenderTarget & fb, const PPC & ppc, const Texture & texture)
 {
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -613,10 +1213,7 @@ void TMesh::drawTextured(SWFrameBuffer & fb, const PPC & ppc, const Texture & te
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -627,6 +1224,10 @@ void TMesh::drawTextured(SWFrameBuffer & fb, const PPC & ppc, const Texture & te
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -658,7 +1259,7 @@ void TMesh::drawTextured(SWFrameBuffer & fb, const PPC & ppc, const Texture & te
 		tParameters[1] = tcs[tris[3 * tri + 1] * 2 + 1];
 		tParameters[2] = tcs[tris[3 * tri + 2] * 2 + 1];
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -669,26 +1270,25 @@ void TMesh::drawTextured(SWFrameBuffer & fb, const PPC & ppc, const Texture & te
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
 
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
 				fb.draw2DTexturedTriangle(
 					tProjVerts, currcols,
 					sParameters, tParameters,
 					perspCorrectMatQ,
-					texture);
+					texture, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
 void TMesh::drawSprite(
-	SWFrameBuffer & fb, 
+	SWRenderTarget & fb, 
 	const PPC & ppc, 
 	const Texture & texture,
 	unsigned int subSIndex, 
@@ -712,10 +1312,7 @@ void TMesh::drawSprite(
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -726,6 +1323,10 @@ void TMesh::drawSprite(
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -775,7 +1376,7 @@ void TMesh::drawSprite(
 			tParameters[2] *= (subTIndex + 1) * (1 / (float)subTTotal);
 		}
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -786,26 +1387,25 @@ void TMesh::drawSprite(
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
 
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
 				fb.draw2DSprite(
 					tProjVerts, currcols,
 					sParameters, tParameters,
 					perspCorrectMatQ,
-					texture);
+					texture, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
 void TMesh::drawLit(
-	SWFrameBuffer &fb,
+	SWRenderTarget &fb,
 	const PPC &ppc,
 	const Light &light,
 	const LightProjector *const lightProj,
@@ -834,10 +1434,7 @@ void TMesh::drawLit(
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -849,6 +1446,10 @@ void TMesh::drawLit(
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -892,7 +1493,7 @@ void TMesh::drawLit(
 			tParameters = V3(0.0f, 1.0f, 1.0f);
 		}
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -903,42 +1504,28 @@ void TMesh::drawLit(
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
-
-				if (isColorsOn) {
-					fb.draw2DLitTriangle(
-						currvs, tProjVerts, currcols, currnormals,
-						light, perspCorrectMatQ,
-						sParameters, tParameters,
-						texture,
-						isShadowMapOn,
-						ppc,
-						isLightProjOn,
-						lightProj);
-				}
-				else {
-					fb.draw2DLitTriangle(
-						currvs, tProjVerts, nullptr, currnormals,
-						light, perspCorrectMatQ,
-						sParameters, tParameters,
-						texture,
-						isShadowMapOn,
-						ppc,
-						isLightProjOn,
-						lightProj);
-				}
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
+
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
+				fb.draw2DLitTriangle(
+					currvs, tProjVerts, isColorsOn ? currcols : nullptr, currnormals,
+					light, perspCorrectMatQ,
+					sParameters, tParameters,
+					texture,
+					isShadowMapOn,
+					ppc,
+					isLightProjOn,
+					lightProj, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
-void TMesh::drawFilledFlatWithDepth(SWFrameBuffer & fb, const PPC & ppc, unsigned int color)
+void TMesh::drawFilledFlatWithDepth(SWRenderTarget & fb, const PPC & ppc, unsigned int color)
 {
 	if ((vertsN == 0) || (trisN < 1)) {
 		cerr << "ERROR: Attempted to draw an empty mesh. "
@@ -950,6 +1537,10 @@ void TMesh::drawFilledFlatWithDepth(SWFrameBuffer & fb, const PPC & ppc, unsigne
 	V3 tProjVerts[3];
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -963,7 +1554,7 @@ void TMesh::drawFilledFlatWithDepth(SWFrameBuffer & fb, const PPC & ppc, unsigne
 		isVisible &= isVertProjVis[tris[3 * tri + 1]];
 		isVisible &= isVertProjVis[tris[3 * tri + 2]];
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -972,16 +1563,84 @@ void TMesh::drawFilledFlatWithDepth(SWFrameBuffer & fb, const PPC & ppc, unsigne
 				tProjVerts[2]);
 
 			if (projTriangleArea > epsilonMinArea) {
-				fb.draw2DFlatTriangleWithDepth(tProjVerts, color);
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
+				fb.draw2DFlatTriangleWithDepth(tProjVerts, color, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
+}
+
+void TMesh::drawDepthOnly(SWDepthTarget & dt, const PPC & ppc, int rowsTop, int rowsBottom) const
+{
+	if ((vertsN == 0) || (trisN < 1)) {
+		cerr << "ERROR: Attempted to draw an empty mesh. "
+			<< "drawDepthOnly() command was aborted." << endl;
+		return;
+	}
+	if (isAABBOutsideFrustum(ppc))
+		return;
+
+	// this thread's own projection of the mesh
+	vector<V3> localProjVerts(vertsN);
+	std::unique_ptr<bool[]> isLocalProjVis(new bool[vertsN]);
+	if (!isSoAVertsDirty)
+		ppc.projectBatch(vertsX, vertsY, vertsZ, vertsN, localProjVerts.data(), isLocalProjVis.get());
+	else {
+		// SoA copy is stale and updating it would write to the mesh
+		for (int vi = 0; vi < vertsN; vi++)
+			isLocalProjVis[vi] = ppc.project(verts[vi], localProjVerts[vi]);
+	}
+
+	// meshlets (chunked mesh files only) let whole groups of triangles
+	// off the frustum go at once, e.g. most of a terrain in a cascade
+	bool isMeshletCullingOn = (meshlets != nullptr) && (meshletsVertsStamp == vertsStamp);
+	V3 planeNormals[PPC::K_FRUSTUM_PLANES_N];
+	if (isMeshletCullingOn)
+		ppc.getFrustumPlanes(planeNormals);
+
+	float w = (float)ppc.getWidth(), h = (float)ppc.getHeight();
+	V3 tProjVerts[3];
+	int rangesN = isMeshletCullingOn ? meshletsN : 1;
+	for (int ri = 0; ri < rangesN; ri++) {
+		int firstTri = 0, endTri = trisN;
+		if (isMeshletCullingOn) {
+			const Meshlet &meshlet = meshlets[ri];
+			if (isBoxOutsideFrustum(V3(meshlet.aabbMin[0], meshlet.aabbMin[1], meshlet.aabbMin[2]),
+				V3(meshlet.aabbMax[0], meshlet.aabbMax[1], meshlet.aabbMax[2]),
+				planeNormals, ppc.getEyePoint()))
+				continue;
+			firstTri = (int)meshlet.firstTri;
+			endTri = firstTri + (int)meshlet.trisN;
+		}
+		for (int tri = firstTri; tri < endTri; tri++) {
+			unsigned int i0 = tris[3 * tri + 0], i1 = tris[3 * tri + 1], i2 = tris[3 * tri + 2];
+			if (!isLocalProjVis[i0] || !isLocalProjVis[i1] || !isLocalProjVis[i2])
+				continue;
+			tProjVerts[0] = localProjVerts[i0];
+			tProjVerts[1] = localProjVerts[i1];
+			tProjVerts[2] = localProjVerts[i2];
+			if (isProjTriangleOffImage(tProjVerts[0], tProjVerts[1], tProjVerts[2], w, h) ||
+				(isBackFaceCullingOn && isTriangleBackFacing(tri, ppc.getEyePoint())))
+				continue;
+			// not even close to this band of rows
+			float minV = min(tProjVerts[0][1], min(tProjVerts[1][1], tProjVerts[2][1]));
+			float maxV = max(tProjVerts[0][1], max(tProjVerts[1][1], tProjVerts[2][1]));
+			if (maxV < (float)rowsTop || minV > (float)rowsBottom)
+				continue;
+			// same small triangle rejection as drawFilledFlatWithDepth, minus
+			// the warning which would be printed once per face or band
+			if (compute2DTriangleArea(tProjVerts[0], tProjVerts[1], tProjVerts[2]) > epsilonMinArea)
+				dt.draw2DTriangleDepth(tProjVerts, rowsTop, rowsBottom);
+		}
+	}
 }
 
 void TMesh::drawStealth(
-	SWFrameBuffer & fb, 
+	SWRenderTarget & fb, 
 	const PPC & ppc, 
 	const Light & light, 
 	const LightProjector & lightProj,
@@ -1009,10 +1668,7 @@ void TMesh::drawStealth(
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -1024,6 +1680,10 @@ void TMesh::drawStealth(
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -1067,7 +1727,7 @@ void TMesh::drawStealth(
 			tParameters = V3(0.0f, 1.0f, 1.0f);
 		}
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -1078,37 +1738,167 @@ void TMesh::drawStealth(
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
 
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
 				fb.draw2DStealthTriangle(
 					currvs, tProjVerts, currcols, currnormals,
 					light, perspCorrectMatQ,
 					isLightOn, isTexturedOn,
 					sParameters, tParameters,
 					texture,
-					ppc,					
-					lightProj);
+					ppc,
+					lightProj, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
 void TMesh::projectVertices(const PPC & ppc)
 {
+	// nothing moved since last time, projVerts and the triangle setups
+	// are still good
+	if (!isSoAVertsDirty && setupPPC != nullptr && *setupPPC == ppc)
+		return;
+
+	if (isSoAVertsDirty)
+		updateSoAVerts();
+	if (projVerts == nullptr) {
+		projVerts = new V3[vertsN];
+		isVertProjVis = new bool[vertsN];
+	}
+	// whole mesh in one go, several vertices at a time
+	ppc.projectBatch(vertsX, vertsY, vertsZ, vertsN, projVerts, isVertProjVis);
+
+	if (setupPPC == nullptr)
+		setupPPC = new PPC(ppc);
+	else
+		*setupPPC = ppc;
+	if (triSetups == nullptr)
+		triSetups = new TriangleSetupCache[trisN](); // generations start at 0
+	projGeneration++;
+}
+
+const M33 & TMesh::getPerspCorrectMatQ(int tri)
+{
+	TriangleSetupCache &cache = triSetups[tri];
+	if (cache.qGeneration != projGeneration) {
+		M33 VMinC, abc;
+		abc.setColumn(setupPPC->getLowerCaseA(), 0);
+		abc.setColumn(setupPPC->getLowerCaseB(), 1);
+		abc.setColumn(setupPPC->getLowerCaseC(), 2);
+		V3 eye = setupPPC->getEyePoint();
+		VMinC.setColumn(verts[tris[3 * tri + 0]] - eye, 0);
+		VMinC.setColumn(verts[tris[3 * tri + 1]] - eye, 1);
+		VMinC.setColumn(verts[tris[3 * tri + 2]] - eye, 2);
+		VMinC.setInverted();
+		cache.perspCorrectMatQ = VMinC * abc;
+		cache.qGeneration = projGeneration;
+	}
+	return cache.perspCorrectMatQ;
+}
+
+const SWRenderTarget::TriangleSetup * TMesh::getRasterSetup(int tri)
+{
+	TriangleSetupCache &cache = triSetups[tri];
+	if (cache.rasterSetupGeneration != projGeneration) {
+		V3 tProjVerts[3];
+		tProjVerts[0] = projVerts[tris[3 * tri + 0]];
+		tProjVerts[1] = projVerts[tris[3 * tri + 1]];
+		tProjVerts[2] = projVerts[tris[3 * tri + 2]];
+		SWRenderTarget::computeTriangleSetup(tProjVerts, cache.rasterSetup);
+		cache.rasterSetupGeneration = projGeneration;
+	}
+	return &cache.rasterSetup;
+}
+
+void TMesh::resetCullStats(void)
+{
+	cullStats.meshesCulledN = 0;
+	cullStats.meshTrisCulledN = 0;
+	cullStats.frustumCulledN = 0;
+	cullStats.backFaceCulledN = 0;
+}
+
+bool TMesh::isMeshCulled(const PPC & ppc)
+{
+	if (isAABBOutsideFrustum(ppc)) {
+		cullStats.meshesCulledN++;
+		cullStats.meshTrisCulledN += trisN;
+		return true;
+	}
+	return false;
+}
+
+bool TMesh::isAABBOutsideFrustum(const PPC & ppc) const
+{
+	if (aabb == nullptr)
+		return false;
+
+	V3 planeNormals[PPC::K_FRUSTUM_PLANES_N];
+	ppc.getFrustumPlanes(planeNormals);
+	return isBoxOutsideFrustum(aabb->getFristCorner(), aabb->getSecondCorner(),
+		planeNormals, ppc.getEyePoint());
+}
+
+bool TMesh::isTriangleCulled(int tri, const PPC & ppc)
+{
+	if (isProjTriangleOffImage(projVerts[tris[3 * tri + 0]], projVerts[tris[3 * tri + 1]],
+		projVerts[tris[3 * tri + 2]], (float)ppc.getWidth(), (float)ppc.getHeight())) {
+		cullStats.frustumCulledN++;
+		return true;
+	}
+
+	if (isBackFaceCullingOn && isTriangleBackFacing(tri, ppc.getEyePoint())) {
+		cullStats.backFaceCulledN++;
+		return true;
+	}
+	return false;
+}
+
+bool TMesh::isTriangleBackFacing(int tri, const V3 & eye) const
+{
+	// front faces have counter clockwise vertices seen from the camera
+	const V3 &v0 = verts[tris[3 * tri + 0]];
+	const V3 &v1 = verts[tris[3 * tri + 1]];
+	const V3 &v2 = verts[tris[3 * tri + 2]];
+	V3 faceNormal = (v1 - v0) ^ (v2 - v0);
+	return faceNormal * (v0 - eye) >= 0.0f;
+}
+
+void TMesh::updateSoAVerts(void)
+{
+	int paddedVertsN = (vertsN + K_SOA_PADDING - 1) / K_SOA_PADDING * K_SOA_PADDING;
+	if (paddedVertsN > soaVertsCapacity) {
+		if (vertsX) {
+			_mm_free(vertsX);
+			_mm_free(vertsY);
+			_mm_free(vertsZ);
+		}
+		vertsX = (float *)_mm_malloc(paddedVertsN * sizeof(float), 32);
+		vertsY = (float *)_mm_malloc(paddedVertsN * sizeof(float), 32);
+		vertsZ = (float *)_mm_malloc(paddedVertsN * sizeof(float), 32);
+		soaVertsCapacity = paddedVertsN;
+	}
 	for (int vi = 0; vi < vertsN; vi++) {
-		isVertProjVis[vi] = ppc.project(verts[vi], projVerts[vi]);
+		vertsX[vi] = verts[vi].getX();
+		vertsY[vi] = verts[vi].getY();
+		vertsZ[vi] = verts[vi].getZ();
+	}
+	// padding gets projected too but never read back
+	for (int vi = vertsN; vi < paddedVertsN; vi++) {
+		vertsX[vi] = vertsY[vi] = vertsZ[vi] = 0.0f;
 	}
+	isSoAVertsDirty = false;
 }
 
 void TMesh::drawReflective(
 	CubeMap &cubeMap,
-	SWFrameBuffer & fb, 
+	SWRenderTarget & fb, 
 	const PPC & ppc, 
 	const Texture * 
 	const texture, 
@@ -1134,10 +1924,7 @@ void TMesh::drawReflective(
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -1149,6 +1936,10 @@ void TMesh::drawReflective(
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -1192,7 +1983,7 @@ void TMesh::drawReflective(
 			tParameters = V3(0.0f, 1.0f, 1.0f);
 		}
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -1203,39 +1994,28 @@ void TMesh::drawReflective(
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
-
-				if (isColorsOn) {
-					fb.draw2DReflectiveTriangle(
-						cubeMap, ppc,
-						currvs, tProjVerts, currcols, currnormals,
-						perspCorrectMatQ,
-						sParameters, tParameters,
-						texture);
-				}
-				else {
-					fb.draw2DReflectiveTriangle(
-						cubeMap, ppc,
-						currvs, tProjVerts, nullptr, currnormals,
-						perspCorrectMatQ,
-						sParameters, tParameters,
-						texture);
-				}
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
+
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
+				fb.draw2DReflectiveTriangle(
+					cubeMap, ppc,
+					currvs, tProjVerts, isColorsOn ? currcols : nullptr, currnormals,
+					perspCorrectMatQ,
+					sParameters, tParameters,
+					texture, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
 void TMesh::drawRefractive(
 	float nl, float nt, 
 	CubeMap & cubeMap, 
-	SWFrameBuffer & fb, 
+	SWRenderTarget & fb, 
 	const PPC & ppc, 
 	const Texture * const texture, 
 	bool isColorsOn)
@@ -1260,10 +2040,7 @@ void TMesh::drawRefractive(
 	// interpolation of raster parameters.
 	// (refer to slide 7 of RastParInterp.pdf for the math 
 	// derivation of Q matrix)
-	M33 perspCorrectMatQ, VMinC, abc;
-	abc.setColumn(ppc.getLowerCaseA(), 0);
-	abc.setColumn(ppc.getLowerCaseB(), 1);
-	abc.setColumn(ppc.getLowerCaseC(), 2);
+	M33 perspCorrectMatQ;
 
 	// Draw textured triangles with s,t linearly
 	// interpolated in model space and depth linearly
@@ -1275,6 +2052,10 @@ void TMesh::drawRefractive(
 	V3 sParameters, tParameters;
 	bool isVisible;
 
+	// whole mesh outside the view frustum
+	if (isMeshCulled(ppc))
+		return;
+
 	// optimization: project each vertex only once
 	projectVertices(ppc);
 
@@ -1318,7 +2099,7 @@ void TMesh::drawRefractive(
 			tParameters = V3(0.0f, 1.0f, 1.0f);
 		}
 
-		if (isVisible) {
+		if (isVisible && !isTriangleCulled(tri, ppc)) {
 
 			// Rasterizer should reject triangles whose screen footprint is very small.
 			float projTriangleArea = compute2DTriangleArea(
@@ -1329,35 +2110,25 @@ void TMesh::drawRefractive(
 			if (projTriangleArea > epsilonMinArea) {
 
 				// build model space linear interpolation for s and t
-				VMinC.setColumn(currvs[0] - ppc.getEyePoint(), 0);
-				VMinC.setColumn(currvs[1] - ppc.getEyePoint(), 1);
-				VMinC.setColumn(currvs[2] - ppc.getEyePoint(), 2);
-				VMinC.setInverted();
-				perspCorrectMatQ = VMinC * abc;
-
-				if (isColorsOn) {
-					fb.draw2DRefractiveTriangle(
-						nl, nt, cubeMap, ppc,
-						currvs, tProjVerts, currcols, currnormals,
-						perspCorrectMatQ,
-						sParameters, tParameters,
-						texture);
-				}
-				else {
-					fb.draw2DRefractiveTriangle(
-						nl, nt, cubeMap, ppc,
-						currvs, tProjVerts, nullptr, currnormals,
-						perspCorrectMatQ,
-						sParameters, tParameters,
-						texture);
-				}
+				perspCorrectMatQ = getPerspCorrectMatQ(tri); // cached per view
+
+				const SWRenderTarget::TriangleSetup *setup = getRasterSetup(tri);
+				fb.draw2DRefractiveTriangle(
+					nl, nt, cubeMap, ppc,
+					currvs, tProjVerts, isColorsOn ? currcols : nullptr, currnormals,
+					perspCorrectMatQ,
+					sParameters, tParameters,
+					texture, setup);
 			}
 			else
 				cerr << "WARNING: Triangle screen footprint is stoo small, discarding..." << endl;
 		}
 	}
+	// rasterize whatever got binned (no-op unless tiled rendering is on)
+	fb.flushTiles();
 }
 
+#ifndef SW_HEADLESS
 void TMesh::hwGLFixedPiepelineDraw(void) const
 {
 	// Draw using old OpenGL fixed pipeline functionlity API (this is deprecated functionality)
@@ -1464,6 +2235,7 @@ bool TMesh::getIsGLVertexArrayObjectCreated(void) const
 {
 	return isHwSupportEnabled;
 }
+#endif
 
 bool TMesh::getIsTexCoordsAvailable(void) const
 {
@@ -1472,8 +2244,9 @@ bool TMesh::getIsTexCoordsAvailable(void) const
 
 void TMesh::disableTexCoords(void)
 {
-	if (tcs != nullptr)
-		delete tcs;
+	// mapped meshes keep tcs in the mapping, see cleanUp
+	if (tcs != nullptr && mappedFile == nullptr)
+		delete[] tcs;
 	tcs = nullptr;
 }
 
@@ -1516,6 +2289,8 @@ void TMesh::rotateAboutAxis(const V3 &aO, const V3 &adir, float theta)
 			normals[vi].rotateThisVectorAboutDirection(adir, theta);
 		}
 	}
+	isSoAVertsDirty = true;
+	vertsStamp = getNewVertsStamp();
 	// recompute AABB
 	delete aabb;
 	aabb = nullptr;
@@ -1538,7 +2313,7 @@ AABB TMesh::computeAABB(void) const
 	}
 }
 
-void TMesh::drawAABB(SWFrameBuffer & fb, const PPC & ppc, unsigned int colorNear, unsigned int colorFar) const
+void TMesh::drawAABB(SWRenderTarget & fb, const PPC & ppc, unsigned int colorNear, unsigned int colorFar) const
 {
 
 
@@ -1572,6 +2347,8 @@ void TMesh::scale(float scaleFactor)
 	for (int vi = 0; vi < vertsN; vi++) {
 		verts[vi] = verts[vi] * scaleFactor;
 	}
+	isSoAVertsDirty = true;
+	vertsStamp = getNewVertsStamp();
 	// recompute AABB
 	delete aabb;
 	aabb = nullptr;
@@ -1583,6 +2360,8 @@ void TMesh::translate(const V3 & translationVector)
 	for (int vi = 0; vi < vertsN; vi++) {
 		verts[vi] = verts[vi] + translationVector;
 	}
+	isSoAVertsDirty = true;
+	vertsStamp = getNewVertsStamp();
 	// recompute AABB
 	delete aabb;
 	aabb = nullptr;
@@ -3,17 +3,48 @@
 #include "ppc.h"
 #include "aabb.h"
 #include "texture.h"
-#include "sw_framebuffer.h"
+#include "sw_rendertarget.h"
+class SWDepthTarget;
+class MappedFile;
 
 // Implements a triangle mesh class that stores shared vertices and triangle 
 // connectivity data.
 class TMesh {
+public:
+	// group of consecutive triangles (at most K_MESHLET_MAX_TRIS, using at
+	// most K_MESHLET_MAX_VERTS vertices) with their bounding box, stored in
+	// chunked mesh files. Only drawDepthOnly uses them, to skip whole groups
+	// off a shadow map frustum; the other draws cull per mesh and triangle
+	struct Meshlet {
+		unsigned int firstTri;
+		unsigned int trisN;
+		float aabbMin[3];
+		float aabbMax[3];
+	};
+	static const int K_MESHLET_MAX_TRIS = 124;
+	static const int K_MESHLET_MAX_VERTS = 64;
+	static const unsigned int K_CHUNKED_MESH_VERSION = 1;
+	// post transform vertex cache size optimizeTriangleOrder targets and
+	// computeACMR simulates by default
+	static const int K_VERTEX_CACHE_SIZE = 32;
 private:
 	V3 *verts; // verices
 	// leverage vertex shared triangles to avoid paying for projection
-	// more than once:
+	// more than once (allocated on first projection):
 	V3 *projVerts; // projected vertices
 	bool *isVertProjVis; // quickly look up vertex projection status 
+	// structure of arrays copy of verts for batched projection. Each array
+	// is 32 byte aligned and padded to a multiple of K_SOA_PADDING floats so
+	// it can be read with full width vector loads. Rebuilt lazily after verts
+	// change (see isSoAVertsDirty)
+	float *vertsX, *vertsY, *vertsZ;
+	int soaVertsCapacity; // allocated floats per SoA array
+	bool isSoAVertsDirty;
+	bool isSoAVertsMapped; // vertsX, vertsY, vertsZ point into mappedFile
+	// process wide unique stamp, renewed whenever verts change (or the mesh
+	// gets rebuilt), so users caching anything made from this mesh (e.g.
+	// shadow maps) can tell whether it moved
+	unsigned int vertsStamp;
 	V3 *cols; // colors arrays
 	V3 *normals;
 	float *tcs; // texture coorindates array (s,t)'s
@@ -21,26 +52,114 @@ private:
 	unsigned int *tris; // triangle indices array of size trisN*3
 	int trisN; // number of triangle (not number of indices in array)
 	AABB *aabb; // keeps track of current axis aligned box
+	// set when loaded memory mapped: verts, cols, normals, tcs and tris then
+	// point straight into the mapped bin file instead of owning new[] arrays.
+	// The mapping is copy on write, so transforming the mesh only copies
+	// the pages it changes
+	MappedFile *mappedFile;
+	// only chunked mesh files have meshlets, which also live in mappedFile.
+	// They are good as long as verts are the ones they were loaded with
+	const Meshlet *meshlets;
+	int meshletsN;
+	unsigned int meshletsVertsStamp;
 
-	// optional hardware rendering support with VAO (VBOs)
+	// optional hardware rendering support with VAO (VBOs). GL object names
+	// are GLuint, spelled out so this header does not need OpenGL
 	bool isHwSupportEnabled;
-	GLuint vertexBuffer[4] = { 0, 0, 0, 0 };
-	GLuint indexBuffer;
-	GLuint vao; // vertex array object
+	unsigned int vertexBuffer[4] = { 0, 0, 0, 0 };
+	unsigned int indexBuffer;
+	unsigned int vao; // vertex array object
 
 	void cleanUp(void); // helper function for destructor
+	// loadBin, memory mapped: points the attribute arrays into the bin file
+	void mapBin(const char *fname);
+	// splits the triangles, in their current order, into meshlets
+	vector<Meshlet> buildMeshlets(void) const;
 	AABB computeAABB(void) const; // computes a bounding box of the centers
 	void projectVertices(const PPC &ppc); // optimization: project each vertex only once
+	void updateSoAVerts(void); // copies verts into vertsX, vertsY, vertsZ
+
+	// per triangle setup cache. Everything below only depends on the camera
+	// and on verts, so redraws from the same view (e.g. only the light or the
+	// texture changed) reuse it. projectVertices() bumps projGeneration
+	// whenever it actually has to reproject, i.e. when the camera differs
+	// from setupPPC or verts changed; entries built for an older generation
+	// are stale and get rebuilt on first use.
+	struct TriangleSetupCache {
+		M33 perspCorrectMatQ; // model space interpolation (see RastParInterp.pdf)
+		SWRenderTarget::TriangleSetup rasterSetup; // edge equations, 1/w plane
+		unsigned int qGeneration; // projGeneration the fields above were built for
+		unsigned int rasterSetupGeneration;
+	};
+	TriangleSetupCache *triSetups; // trisN entries, allocated on first projection
+	PPC *setupPPC; // copy of the camera verts were last projected with
+	unsigned int projGeneration;
+	const M33 &getPerspCorrectMatQ(int tri);
+	const SWRenderTarget::TriangleSetup *getRasterSetup(int tri);
 public:	
+	static const int K_SOA_PADDING = 8;
+
+	// how many triangles each culling test removed since the last
+	// resetCullStats(). Culling runs before any per triangle setup
+	struct CullStats {
+		int meshesCulledN; // draw calls skipped because AABB is outside frustum
+		int meshTrisCulledN; // triangles of the meshes above
+		int frustumCulledN; // triangles entirely off one side of the image
+		int backFaceCulledN; // triangles facing away from the camera
+	};
+private:
+	CullStats cullStats;
+	// back-face culling is opt in since open meshes such as the quads
+	// are meant to be seen from both sides
+	bool isBackFaceCullingOn;
+	// true if aabb is outside the view frustum of ppc
+	bool isMeshCulled(const PPC &ppc);
+	// true if triangle tri (already projected) can't show up in the image
+	bool isTriangleCulled(int tri, const PPC &ppc);
+	// the two tests above without touching cullStats
+	bool isAABBOutsideFrustum(const PPC &ppc) const;
+	bool isTriangleBackFacing(int tri, const V3 &eye) const;
+public:
 	// empty constructor
 	TMesh();
 	// constructor out of bin file
-	TMesh(const char *fname);
+	TMesh(const char *fname, bool isMemoryMapped = false);
 	// destructor
 	~TMesh();
 
-	// loads triangle mesh from binary file
-	void loadBin(const char *fname);
+	// loads triangle mesh from binary file. Memory mapped loading reads
+	// nothing up front: the file is used in place and only the pages that
+	// get touched are read (see mappedFile)
+	void loadBin(const char *fname, bool isMemoryMapped = false);
+	bool getIsMemoryMapped(void) const { return mappedFile != nullptr; }
+	// chunked mesh files: a versioned header with the vertex and triangle
+	// counts and the AABB, then a table of 32 byte aligned chunks (AoS and
+	// SoA positions, colors, normals, tex coords, triangles, meshlets).
+	// loadChunked maps the file and uses every chunk in place, nothing is
+	// read or recomputed up front; a chunk only comes in from disk once a
+	// draw touches it. Returns false (and leaves the mesh empty) for bad files
+	bool loadChunked(const char *fname);
+	bool saveChunked(const string &filename) const;
+	// geometry/bunny.bin -> geometry/bunny.cmesh
+	static string getChunkedPath(const string &binFilename);
+	// renumbers vertices in the order triangles first use them, so drawing
+	// walks the vertex arrays mostly forward. Doesn't change the triangle order
+	void reorderVerticesByFirstUse(void);
+	// reorders the triangles for post transform vertex cache reuse (Tom
+	// Forsyth's linear speed vertex cache optimization, LRU cache of
+	// K_VERTEX_CACHE_SIZE). Drops the meshlets, their triangle ranges don't
+	// hold anymore, so shadow passes cull per triangle until saveChunked
+	// rebuilds them (tools/meshbake.cpp reorders before saving). GL buffers
+	// aren't updated, so run it before createGLVertexArrayObject
+	void optimizeTriangleOrder(void);
+	// optimizeTriangleOrder then reorderVerticesByFirstUse, at load time or
+	// offline (tools/meshbake.cpp). Prints the ACMR before and after
+	void optimizeVertexCache(void);
+	// average cache miss ratio: vertices transformed per triangle with a
+	// FIFO post transform cache of cacheSize, 0.5 is the best a closed mesh
+	// can do, 3 means no reuse at all
+	float computeACMR(int cacheSize = K_VERTEX_CACHE_SIZE) const;
+	int getMeshletsN(void) const { return meshletsN; }
 
 	// get number of unique vertices in this triangle mesh
 	int getVertsN(void) const { return vertsN; }
@@ -52,32 +171,40 @@ public:
 	V3 getVertexColor(int i) const;
 	// returns triangle index at index i or -1 when initialized
 	int getTriangleIndex(int i) const;
+	// changes whenever the vertices do, see vertsStamp
+	unsigned int getVertsStamp(void) const { return vertsStamp; }
+
+	// culling control and statistics
+	void setIsBackFaceCullingOn(bool value) { isBackFaceCullingOn = value; }
+	bool getIsBackFaceCullingOn(void) const { return isBackFaceCullingOn; }
+	CullStats getCullStats(void) const { return cullStats; }
+	void resetCullStats(void);
 
 	// drawing functionality using SW Framebuffer
 
 	// draws the triangle mesh vertices as dots
-	void drawVertexDots(SWFrameBuffer &fb, const PPC &ppc, float dotSize);
+	void drawVertexDots(SWRenderTarget &fb, const PPC &ppc, float dotSize);
 	// draws triangle mesh in wireframe mode
-	void drawWireframe(SWFrameBuffer &fb, const PPC &ppc);
+	void drawWireframe(SWRenderTarget &fb, const PPC &ppc);
 	// draws triangle mesh in filled mode using a single color
-	void drawFilledFlat(SWFrameBuffer &fb, const PPC &ppc, unsigned int color);
+	void drawFilledFlat(SWRenderTarget &fb, const PPC &ppc, unsigned int color);
 	// draws triangle mesh in filled mode using screen space interpolation of colors
-	void drawFilledFlatBarycentric(SWFrameBuffer &fb, const PPC &ppc);
+	void drawFilledFlatBarycentric(SWRenderTarget &fb, const PPC &ppc);
 	// draws triangle mesh in filled mode using model space interpolation of colors
-	void drawFilledFlatPerspCorrect(SWFrameBuffer &fb, const PPC &ppc);
+	void drawFilledFlatPerspCorrect(SWRenderTarget &fb, const PPC &ppc);
 	// draws triangle mesh in texture mode using model space for s,t linear interpolation 
 	// and screen space for depth linear interpolation
-	void drawTextured(SWFrameBuffer &fb, const PPC &ppc, const Texture &texture);
+	void drawTextured(SWRenderTarget &fb, const PPC &ppc, const Texture &texture);
 	// same as drawTextured but fragments are discarded based on alpha value. If animated = true
 	// then this function iterates over the sprite atlas texture using time as an input
-	void drawSprite(SWFrameBuffer &fb, const PPC &ppc, const Texture &texture,
+	void drawSprite(SWRenderTarget &fb, const PPC &ppc, const Texture &texture,
 		unsigned int subSIndex = 0, unsigned int subTIndex = 0,
 		unsigned int subSTotal = 1, unsigned int subTTotal = 1);
 	// draws triangle mesh in lit mode using screen space interpolation for 1/w and model
 	// space interpolation for color and s,t parameters. Uses texture if available and uses
 	// texture maps if requested.
 	void drawLit(
-		SWFrameBuffer &fb, 
+		SWRenderTarget &fb, 
 		const PPC &ppc, 
 		const Light &light,
 		const LightProjector *const lightProj = nullptr,
@@ -87,10 +214,16 @@ public:
 		bool isLightProjOn = false);
 	// draws triangle mesh in filled mode using a single color and depth 1/w in screen
 	// coordinates mainly for shadow mapping purposes
-	void drawFilledFlatWithDepth(SWFrameBuffer &fb, const PPC &ppc, unsigned int color);
+	void drawFilledFlatWithDepth(SWRenderTarget &fb, const PPC &ppc, unsigned int color);
+	// draws 1/w only, into rows [rowsTop, rowsBottom) of a shadow map. Only
+	// reads the mesh: vertices are projected into a local buffer, nothing is
+	// cached or counted, so several threads can draw the same mesh at once
+	// (e.g. into the faces of a shadow cube map or bands of one shadow map).
+	// Chunked meshes skip the meshlets that are off the frustum
+	void drawDepthOnly(SWDepthTarget &dt, const PPC &ppc, int rowsTop, int rowsBottom) const;
 	// draws triangle mesh in stealth mode to support David Copperfiled magic trick
 	void drawStealth(
-		SWFrameBuffer &fb,
+		SWRenderTarget &fb,
 		const PPC &ppc,
 		const Light &light,
 		const LightProjector &lightProj,
@@ -102,7 +235,7 @@ public:
 	// TODO: Add a light to generate specular highlights
 	void drawReflective(
 		CubeMap &cubeMap,
-		SWFrameBuffer &fb,
+		SWRenderTarget &fb,
 		const PPC &ppc,
 		const Texture *const texture = nullptr,
 		bool isColorsOn = false);
@@ -111,16 +244,19 @@ public:
 	void drawRefractive(
 		float nl, float nt, // nl = refractive index for medium, nt = refractive index of TMesh material
 		CubeMap &cubeMap,
-		SWFrameBuffer &fb,
+		SWRenderTarget &fb,
 		const PPC &ppc,
 		const Texture *const texture = nullptr,
 		bool isColorsOn = false);
 
-	// hardware accelerated drawing support (optional)
+	// hardware accelerated drawing support (optional, not available
+	// in SW_HEADLESS builds)
+#ifndef SW_HEADLESS
 	void hwGLFixedPiepelineDraw(void) const;
 	void hwGLVertexArrayObjectDraw(void) const;
 	void createGLVertexArrayObject(void);
 	bool getIsGLVertexArrayObjectCreated(void) const;
+#endif
 	bool getIsTexCoordsAvailable(void) const;
 	void disableTexCoords(void);
 
@@ -136,7 +272,7 @@ public:
 	AABB getAABB(void) const { return computeAABB(); }
 	// draw this triangle mesh's AABB
 	void drawAABB(
-		SWFrameBuffer &fb,
+		SWRenderTarget &fb,
 		const PPC &ppc,
 		unsigned int colorNear,
 		unsigned int colorFar) const;
@@ -0,0 +1,67 @@
+// Chunked mesh baker. Loads bin mesh files and writes each one next to it
+// as a chunked mesh file (TMesh::getChunkedPath, e.g. geometry/bunny.cmesh)
+// with the triangles and vertices reordered for the vertex cache (see
+// TMesh::optimizeVertexCache, the ACMR gets printed), the SoA positions,
+// the AABB and the meshlets precomputed, see TMesh::saveChunked. Load
+// those with TMesh::loadChunked.
+//
+// Usage:
+//   meshbake <mesh.bin> [more.bin ...]
+// e.g. meshbake geometry/*.bin
+//
+// Build (from the source folder, no FLTK/OpenGL needed):
+//   g++ -std=c++14 -O2 -msse2 -DSW_HEADLESS -I. tools/meshbake.cpp
+//       sw_rendertarget.cpp tmesh.cpp ppc.cpp aabb.cpp v3.cpp m33.cpp
+//       light.cpp lightprojector.cpp texture.cpp cubemap.cpp mappedfile.cpp
+//       sw_depthtarget.cpp workerpool.cpp textureregistry.cpp lodepng.cpp -pthread -o meshbake
+
+#ifndef SW_HEADLESS
+#error "meshbake is meant to be built with SW_HEADLESS defined"
+#endif
+
+#include "tmesh.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+using std::cerr;
+using std::endl;
+using std::string;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double getElapsedMs(Clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " <mesh.bin> [more.bin ...]" << endl;
+		return 1;
+	}
+
+	int failedN = 0;
+	for (int i = 1; i < argc; i++) {
+		string binFilename = argv[i];
+		string chunkedFilename = TMesh::getChunkedPath(binFilename);
+
+		TMesh tMesh(binFilename.c_str());
+		if (tMesh.getVertsN() == 0) {
+			cerr << "ERROR: cannot load " << binFilename << endl;
+			failedN++;
+			continue;
+		}
+		Clock::time_point begin = Clock::now();
+		// before saving, the meshlets get built out of the new triangle order
+		tMesh.optimizeVertexCache();
+		if (!tMesh.saveChunked(chunkedFilename)) {
+			failedN++;
+			continue;
+		}
+
+		cerr << "INFO: " << binFilename << " " << tMesh.getVertsN() << " verts, " << tMesh.getTrisN()
+			<< " tris -> " << chunkedFilename << " (" << getElapsedMs(begin) << " ms)" << endl;
+	}
+	return failedN ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// Mesh loading benchmark. Times TMesh::loadBin reading the bin file into
+// new[] arrays against memory mapping it (see TMesh::mapBin), three ways:
+//   load        loadBin alone (includes the AABB, which reads all verts)
+//   first draw  load plus one lit draw, which touches everything else
+//   transform   load plus a translation, the copy on write case
+// Files stay in the OS cache after the first load, so this measures the
+// cost of copying and allocating, not the disk.
+//
+// Usage:
+//   meshbench <mesh.bin> [more.bin ...] [-n loads]
+// e.g. meshbench geometry/bunny.bin geometry/terrain.bin 2>/dev/null
+//
+// Build (from the source folder, no FLTK/OpenGL needed):
+//   g++ -std=c++14 -O2 -msse2 -DSW_HEADLESS -I. tools/meshbench.cpp
+//       sw_rendertarget.cpp tmesh.cpp ppc.cpp aabb.cpp v3.cpp m33.cpp
+//       light.cpp lightprojector.cpp texture.cpp cubemap.cpp mappedfile.cpp
+//       sw_depthtarget.cpp workerpool.cpp textureregistry.cpp lodepng.cpp -pthread -o meshbench
+
+#ifndef SW_HEADLESS
+#error "meshbench is meant to be built with SW_HEADLESS defined"
+#endif
+
+#include "sw_rendertarget.h"
+#include "tmesh.h"
+#include "ppc.h"
+#include "light.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double getElapsedMs(Clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+enum class BenchStep { LOAD, FIRST_DRAW, TRANSFORM };
+
+// average ms of loadsN loads of fname followed by step
+static double benchLoads(const char *fname, bool isMemoryMapped, BenchStep step, int loadsN,
+	SWRenderTarget &fb, const PPC &ppc, const Light &light)
+{
+	double totalMs = 0.0;
+	for (int i = 0; i < loadsN; i++) {
+		Clock::time_point begin = Clock::now();
+		{
+			TMesh tMesh(fname, isMemoryMapped);
+			if (step == BenchStep::FIRST_DRAW)
+				tMesh.drawLit(fb, ppc, light);
+			else if (step == BenchStep::TRANSFORM)
+				tMesh.translate(V3(1.0f, 0.0f, 0.0f));
+		} // unloading is part of the cost
+		totalMs += getElapsedMs(begin);
+	}
+	return totalMs / loadsN;
+}
+
+int main(int argc, char **argv)
+{
+	vector<const char *> fnames;
+	int loadsN = 20;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			loadsN = atoi(argv[++i]);
+		else
+			fnames.push_back(argv[i]);
+	}
+	if (fnames.empty() || loadsN < 1) {
+		cerr << "Usage: " << argv[0] << " <mesh.bin> [more.bin ...] [-n loads]" << endl;
+		return 1;
+	}
+
+	PPC ppc(60.0f, 640, 480);
+	SWRenderTarget fb(640, 480);
+	Light light(true, 60.0f, 640, 480);
+	light.setAmbientK(0.4f);
+	light.setMatColor(V3(1.0f, 0.0f, 0.0f));
+
+	const char *stepNames[3] = { "load", "first draw", "transform" };
+	const BenchStep steps[3] = { BenchStep::LOAD, BenchStep::FIRST_DRAW, BenchStep::TRANSFORM };
+	cout << std::left << std::setw(28) << "mesh" << std::setw(12) << "step"
+		<< std::right << std::setw(12) << "read" << std::setw(12) << "mapped" << "   (ms, "
+		<< loadsN << " loads each)" << endl;
+	for (const char *fname : fnames) {
+		TMesh probe(fname);
+		if (probe.getVertsN() == 0) {
+			cerr << "ERROR: cannot load " << fname << endl;
+			continue;
+		}
+		// look at the mesh so the first draw actually rasterizes it
+		AABB aabb = probe.getAABB();
+		V3 center = (aabb.getFristCorner() + aabb.getSecondCorner()) * 0.5f;
+		float size = (aabb.getSecondCorner() - aabb.getFristCorner()).length();
+		ppc.positionAndOrient(center + V3(0.0f, 0.0f, size), center, V3(0.0f, 1.0f, 0.0f));
+		light.setPosition(ppc.getEyePoint());
+
+		for (int si = 0; si < 3; si++) {
+			cout << std::left << std::setw(28) << fname << std::setw(12) << stepNames[si] << std::right
+				<< std::fixed << std::setprecision(3);
+			for (int mapped = 0; mapped < 2; mapped++) {
+				fb.set(0xFFFFFFFF);
+				fb.clearZB(0.0f);
+				cout << std::setw(12) << benchLoads(fname, mapped != 0, steps[si], loadsN, fb, ppc, light);
+			}
+			cout << endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,228 @@
+// Command line SW renderer. Renders one triangle mesh from a saved camera
+// into a PNG without opening any window, so it runs on machines without a
+// display or OpenGL. Uses the same SWRenderTarget and TMesh drawing code as
+// the interactive application.
+//
+// Usage:
+//   swrender <mesh.bin|mesh.cmesh> <camera.txt> <out.png> [options]
+// Options:
+//   -m, --mode <dots|wireframe|flat|screenspace|modelspace|texture|lit>
+//                          draw mode, defaults to lit
+//   -t, --texture <file.png>  texture for texture mode (optional for lit)
+//   --tiled                tiled multithreaded rasterization
+//   --earlyz               Hi-Z early depth test
+//   --deferred             deferred shading (lit mode)
+//   --aabb                 also draw the mesh bounding box
+//   --nomips               sample the base texture level only
+//   --tiledtex             keep the texture in the tiled texel layout
+//   --fixedfilter          integer bilinear/trilinear texture filtering
+//   --mmap                 memory map the mesh file instead of reading it
+//                          (chunked mesh files, see tools/meshbake.cpp, always are)
+//   --optimize             reorder the mesh for the vertex cache after loading
+//
+// Build (from the source folder, no FLTK/OpenGL needed):
+//   g++ -std=c++14 -O2 -msse2 -DSW_HEADLESS -I. tools/swrender.cpp
+//       sw_rendertarget.cpp tmesh.cpp ppc.cpp aabb.cpp v3.cpp m33.cpp
+//       light.cpp lightprojector.cpp texture.cpp cubemap.cpp mappedfile.cpp
+//       sw_depthtarget.cpp workerpool.cpp textureregistry.cpp lodepng.cpp -pthread -o swrender
+
+#ifndef SW_HEADLESS
+#error "swrender is meant to be built with SW_HEADLESS defined"
+#endif
+
+#include "sw_rendertarget.h"
+#include "tmesh.h"
+#include "ppc.h"
+#include "light.h"
+#include "texture.h"
+#include "drawmodes.h"
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+using std::cerr;
+using std::endl;
+using std::string;
+
+static void printUsage(const char *exeName)
+{
+	cerr << "Usage: " << exeName << " <mesh.bin|mesh.cmesh> <camera.txt> <out.png> [options]" << endl
+		<< "  -m, --mode <dots|wireframe|flat|screenspace|modelspace|texture|lit>" << endl
+		<< "  -t, --texture <file.png>" << endl
+		<< "  --tiled        tiled multithreaded rasterization" << endl
+		<< "  --earlyz       Hi-Z early depth test" << endl
+		<< "  --deferred     deferred shading (lit mode)" << endl
+		<< "  --aabb         also draw the mesh bounding box" << endl
+		<< "  --nomips       sample the base texture level only" << endl
+		<< "  --tiledtex     keep the texture in the tiled texel layout" << endl
+		<< "  --fixedfilter  integer bilinear/trilinear texture filtering" << endl
+		<< "  --mmap         memory map the mesh file instead of reading it" << endl
+		<< "  --optimize     reorder the mesh for the vertex cache after loading" << endl;
+}
+
+static bool parseDrawMode(const string &name, DrawModes &mode)
+{
+	if (name == "dots") mode = DrawModes::DOTS;
+	else if (name == "wireframe") mode = DrawModes::WIREFRAME;
+	else if (name == "flat") mode = DrawModes::FLAT;
+	else if (name == "screenspace") mode = DrawModes::SCREENSCAPELERP;
+	else if (name == "modelspace") mode = DrawModes::MODELSPACELERP;
+	else if (name == "texture") mode = DrawModes::TEXTURE;
+	else if (name == "lit") mode = DrawModes::LIT;
+	else return false;
+	return true;
+}
+
+static bool isReadable(const char *fname)
+{
+	std::ifstream file(fname, std::ios::binary);
+	return (bool)file;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4) {
+		printUsage(argv[0]);
+		return 1;
+	}
+	const char *meshFname = argv[1];
+	const char *cameraFname = argv[2];
+	const char *outFname = argv[3];
+
+	DrawModes drawMode = DrawModes::LIT;
+	const char *textureFname = nullptr;
+	bool isTiled = false, isEarlyZ = false, isDeferred = false, isAABBDrawn = false;
+	bool isMipMapped = true, isTexTiled = false, isFixedFilter = false, isMeshMapped = false;
+	bool isMeshOptimized = false;
+	for (int i = 4; i < argc; i++) {
+		if ((!strcmp(argv[i], "-m") || !strcmp(argv[i], "--mode")) && i + 1 < argc) {
+			if (!parseDrawMode(argv[++i], drawMode)) {
+				cerr << "ERROR: unknown draw mode " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if ((!strcmp(argv[i], "-t") || !strcmp(argv[i], "--texture")) && i + 1 < argc)
+			textureFname = argv[++i];
+		else if (!strcmp(argv[i], "--tiled"))
+			isTiled = true;
+		else if (!strcmp(argv[i], "--earlyz"))
+			isEarlyZ = true;
+		else if (!strcmp(argv[i], "--deferred"))
+			isDeferred = true;
+		else if (!strcmp(argv[i], "--aabb"))
+			isAABBDrawn = true;
+		else if (!strcmp(argv[i], "--nomips"))
+			isMipMapped = false;
+		else if (!strcmp(argv[i], "--tiledtex"))
+			isTexTiled = true;
+		else if (!strcmp(argv[i], "--fixedfilter"))
+			isFixedFilter = true;
+		else if (!strcmp(argv[i], "--mmap"))
+			isMeshMapped = true;
+		else if (!strcmp(argv[i], "--optimize"))
+			isMeshOptimized = true;
+		else {
+			cerr << "ERROR: unknown option " << argv[i] << endl;
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	// PPC and TMesh only complain about files they can't open, catch it here
+	if (!isReadable(cameraFname)) {
+		cerr << "ERROR: cannot open camera file " << cameraFname << endl;
+		return 1;
+	}
+	PPC ppc{ string(cameraFname) };
+
+	TMesh tMesh;
+	string meshFilename = meshFname;
+	if (meshFilename.size() > 6 && meshFilename.compare(meshFilename.size() - 6, 6, ".cmesh") == 0)
+		tMesh.loadChunked(meshFname);
+	else
+		tMesh.loadBin(meshFname, isMeshMapped);
+	if (tMesh.getTrisN() < 1) {
+		cerr << "ERROR: no triangles loaded from " << meshFname << endl;
+		return 1;
+	}
+	if (isMeshOptimized)
+		tMesh.optimizeVertexCache();
+
+	Texture *texture = nullptr;
+	if (textureFname) {
+		texture = new Texture(textureFname);
+		if (texture->getTexWidth() == 0) {
+			cerr << "ERROR: cannot load texture " << textureFname << endl;
+			delete texture;
+			return 1;
+		}
+		if (isTexTiled)
+			texture->setTexelLayout(Texture::TexelLayout::TILED);
+		texture->setIsFixedPointFilteringOn(isFixedFilter);
+	}
+	if (drawMode == DrawModes::TEXTURE && (texture == nullptr || !tMesh.getIsTexCoordsAvailable())) {
+		cerr << "ERROR: texture mode needs a texture and a mesh with texture coordinates" << endl;
+		delete texture;
+		return 1;
+	}
+
+	SWRenderTarget fb(ppc.getWidth(), ppc.getHeight());
+	fb.setIsTiledRenderingOn(isTiled);
+	fb.setIsEarlyDepthTestOn(isEarlyZ);
+	fb.setIsDeferredShadingOn(isDeferred);
+	fb.setIsMipMappingOn(isMipMapped);
+
+	// same head light set up as the interactive scenes
+	Light light(true, ppc.getHfovDeg(), ppc.getWidth(), ppc.getHeight());
+	light.setAmbientK(0.4f);
+	light.setMatColor(V3(1.0f, 0.0f, 0.0f));
+	light.setPosition(ppc.getEyePoint());
+
+	// clear screen
+	fb.set(0xFFFFFFFF);
+	// clear zBuffer
+	if (drawMode == DrawModes::MODELSPACELERP)
+		fb.clearZB(FLT_MAX);
+	else
+		fb.clearZB(0.0f);
+
+	switch (drawMode) {
+	case DrawModes::DOTS:
+		tMesh.drawVertexDots(fb, ppc, 2.0f);
+		break;
+	case DrawModes::WIREFRAME:
+		tMesh.drawWireframe(fb, ppc);
+		break;
+	case DrawModes::FLAT:
+		tMesh.drawFilledFlat(fb, ppc, 0xFFFF0000);
+		break;
+	case DrawModes::SCREENSCAPELERP:
+		tMesh.drawFilledFlatBarycentric(fb, ppc);
+		break;
+	case DrawModes::MODELSPACELERP:
+		tMesh.drawFilledFlatPerspCorrect(fb, ppc);
+		break;
+	case DrawModes::TEXTURE:
+		tMesh.drawTextured(fb, ppc, *texture);
+		break;
+	case DrawModes::LIT:
+		tMesh.drawLit(fb, ppc, light, nullptr,
+			(texture && tMesh.getIsTexCoordsAvailable()) ? texture : nullptr);
+		break;
+	}
+	// see Scene::drawTMesh on why not in model space interpolation mode
+	if (isAABBDrawn && drawMode != DrawModes::MODELSPACELERP)
+		tMesh.drawAABB(fb, ppc, 0xFF00FF00, 0xFF000000);
+	fb.resolveDeferredShading();
+
+	delete texture;
+
+	if (!fb.saveAsPngFile(outFname)) {
+		cerr << "ERROR: could not write " << outFname << endl;
+		return 1;
+	}
+	cerr << "INFO: wrote " << ppc.getWidth() << "x" << ppc.getHeight()
+		<< " image to " << outFname << endl;
+	return 0;
+}
@@ -0,0 +1,64 @@
+// Texture cache baker. Decodes png files, builds their mip chains and
+// writes each one next to the png as a binary texture cache file
+// (Texture::getBinaryCachePath, e.g. pngs/uffizi_cross.png.btex). Texture
+// loads that instead of the png as long as it is newer than the png, so
+// run this again after editing a png (or delete the .btex file).
+//
+// Usage:
+//   texbake <file.png> [more.png ...]
+// e.g. texbake pngs/*.png
+//
+// Build (from the source folder, no FLTK/OpenGL needed):
+//   g++ -std=c++14 -O2 -msse2 -DSW_HEADLESS -I. tools/texbake.cpp
+//       texture.cpp textureregistry.cpp lodepng.cpp -pthread -o texbake
+
+#include "texture.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+using std::cerr;
+using std::endl;
+using std::string;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double getElapsedMs(Clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " <file.png> [more.png ...]" << endl;
+		return 1;
+	}
+
+	int failedN = 0;
+	for (int i = 1; i < argc; i++) {
+		string pngFilename = argv[i];
+		string cacheFilename = Texture::getBinaryCachePath(pngFilename);
+		// a stale cache would be loaded by Texture only if newer than the
+		// png, but don't take the chance
+		std::remove(cacheFilename.c_str());
+
+		Clock::time_point begin = Clock::now();
+		Texture texture(pngFilename);
+		double decodeMs = getElapsedMs(begin);
+		if (texture.getTexWidth() == 0) {
+			cerr << "ERROR: cannot load " << pngFilename << endl;
+			failedN++;
+			continue;
+		}
+		if (!texture.saveBinaryCache(cacheFilename)) {
+			failedN++;
+			continue;
+		}
+
+		cerr << "INFO: " << pngFilename << " " << texture.getTexWidth() << "x" << texture.getTexHeight()
+			<< ", " << texture.getMipLevelsN() << " levels -> " << cacheFilename
+			<< " (png decode " << decodeMs << " ms)" << endl;
+	}
+	return failedN ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+// Texel layout benchmark. Times the SW samplers (float and fixed point
+// filtering) and every draw mode with
+// the texture in ROW_MAJOR and in TILED layout (see Texture::TexelLayout).
+// Each frame rolls the camera a little so triangles get walked across the
+// texture in every direction, not just along texel rows.
+//
+// Usage:
+//   texbench <mesh.bin> <camera.txt> <texture.png> [frames]
+// Large textures (pngs/uffizi_cross.png, pngs/stpeters_cross.png) show the
+// difference best, 128x128 ones fit in cache either way.
+//
+// Build (from the source folder, no FLTK/OpenGL needed):
+//   g++ -std=c++14 -O2 -msse2 -DSW_HEADLESS -I. tools/texbench.cpp
+//       sw_rendertarget.cpp tmesh.cpp ppc.cpp aabb.cpp v3.cpp m33.cpp
+//       light.cpp lightprojector.cpp texture.cpp cubemap.cpp mappedfile.cpp
+//       sw_depthtarget.cpp workerpool.cpp textureregistry.cpp lodepng.cpp -pthread -o texbench
+
+#ifndef SW_HEADLESS
+#error "texbench is meant to be built with SW_HEADLESS defined"
+#endif
+
+#include "sw_rendertarget.h"
+#include "tmesh.h"
+#include "ppc.h"
+#include "light.h"
+#include "texture.h"
+#include "drawmodes.h"
+#include <cfloat>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double getElapsedMs(Clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+static const char *getLayoutName(Texture::TexelLayout layout)
+{
+	return (layout == Texture::TexelLayout::TILED) ? "tiled" : "row major";
+}
+
+// keeps the optimizer from dropping sample loops
+static volatile unsigned int sampleSink;
+
+// samples the whole texture once per pattern, one sample per texel.
+// Bilinear and trilinear run with float and with fixed point filtering
+static void benchSamplers(Texture &texture)
+{
+	const unsigned int w = texture.getTexWidth(), h = texture.getTexHeight();
+	const float ds = 1.0f / (float)w, dt = 1.0f / (float)h;
+	const char *patternNames[3] = { "rows", "columns", "diagonals" };
+	const char *samplerNames[5] = { "nearest", "bilinear", "trilinear lod 1.5",
+		"bilinear fixed", "trilinear fixed" };
+
+	for (int si = 0; si < 5; si++) {
+		texture.setIsFixedPointFilteringOn(si >= 3);
+		for (int pi = 0; pi < 3; pi++) {
+			Clock::time_point begin = Clock::now();
+			unsigned int sum = 0;
+			for (unsigned int i = 0; i < h; i++) {
+				for (unsigned int j = 0; j < w; j++) {
+					// texel center the pattern visits at step (i, j)
+					unsigned int s = j, t = i;
+					if (pi == 1) { s = i % w; t = j % h; }
+					else if (pi == 2) { s = (i + j) % w; t = j % h; }
+					float fs = ((float)s + 0.5f) * ds, ft = ((float)t + 0.5f) * dt;
+					if (si == 0)
+						sum += texture.sampleTexNearTile(fs, ft);
+					else if (si == 1 || si == 3)
+						sum += texture.sampleTexBilinearTile(fs, ft);
+					else
+						sum += texture.sampleTexTrilinearTile(fs, ft, 1.5f);
+				}
+			}
+			sampleSink = sum;
+			double ms = getElapsedMs(begin);
+			cout << "  " << std::left << std::setw(20) << samplerNames[si] << std::setw(10) << patternNames[pi]
+				<< std::right << std::fixed << std::setprecision(2) << std::setw(9) << ms << " ms  "
+				<< std::setw(7) << (double)w * h / (ms * 1000.0) << " Msamples/s" << endl;
+		}
+	}
+	texture.setIsFixedPointFilteringOn(false);
+}
+
+static void drawMesh(DrawModes drawMode, SWRenderTarget &fb, PPC &ppc, TMesh &tMesh,
+	const Light &light, const Texture &texture)
+{
+	fb.set(0xFFFFFFFF);
+	fb.clearZB((drawMode == DrawModes::MODELSPACELERP) ? FLT_MAX : 0.0f);
+	switch (drawMode) {
+	case DrawModes::DOTS:
+		tMesh.drawVertexDots(fb, ppc, 2.0f);
+		break;
+	case DrawModes::WIREFRAME:
+		tMesh.drawWireframe(fb, ppc);
+		break;
+	case DrawModes::FLAT:
+		tMesh.drawFilledFlat(fb, ppc, 0xFFFF0000);
+		break;
+	case DrawModes::SCREENSCAPELERP:
+		tMesh.drawFilledFlatBarycentric(fb, ppc);
+		break;
+	case DrawModes::MODELSPACELERP:
+		tMesh.drawFilledFlatPerspCorrect(fb, ppc);
+		break;
+	case DrawModes::TEXTURE:
+		tMesh.drawTextured(fb, ppc, texture);
+		break;
+	case DrawModes::LIT:
+		tMesh.drawLit(fb, ppc, light, nullptr, &texture);
+		break;
+	}
+	fb.resolveDeferredShading();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4) {
+		cerr << "Usage: " << argv[0] << " <mesh.bin> <camera.txt> <texture.png> [frames]" << endl;
+		return 1;
+	}
+	const char *cameraFname = argv[2];
+	int framesN = (argc > 4) ? atoi(argv[4]) : 60;
+	if (framesN < 1)
+		framesN = 1;
+
+	if (!std::ifstream(cameraFname, std::ios::binary)) {
+		cerr << "ERROR: cannot open camera file " << cameraFname << endl;
+		return 1;
+	}
+	TMesh tMesh;
+	tMesh.loadBin(argv[1]);
+	if (tMesh.getTrisN() < 1 || !tMesh.getIsTexCoordsAvailable()) {
+		cerr << "ERROR: benchmark needs a mesh with texture coordinates" << endl;
+		return 1;
+	}
+	Texture texture(argv[3]);
+	if (texture.getTexWidth() == 0) {
+		cerr << "ERROR: cannot load texture " << argv[3] << endl;
+		return 1;
+	}
+	cout << "INFO: " << texture.getTexWidth() << "x" << texture.getTexHeight() << " texture, "
+		<< texture.getMipLevelsN() << " mip levels, " << tMesh.getTrisN() << " triangles, "
+		<< framesN << " frames per draw mode" << endl;
+
+	const Texture::TexelLayout layouts[2] = {
+		Texture::TexelLayout::ROW_MAJOR, Texture::TexelLayout::TILED };
+
+	for (Texture::TexelLayout layout : layouts) {
+		texture.setTexelLayout(layout);
+		cout << endl << "samplers, " << getLayoutName(layout) << endl;
+		benchSamplers(texture);
+	}
+
+	const DrawModes drawModes[7] = { DrawModes::DOTS, DrawModes::WIREFRAME, DrawModes::FLAT,
+		DrawModes::SCREENSCAPELERP, DrawModes::MODELSPACELERP, DrawModes::TEXTURE, DrawModes::LIT };
+	const char *drawModeNames[7] = { "dots", "wireframe", "flat", "screenspace",
+		"modelspace", "texture", "lit" };
+
+	cout << endl << std::left << std::setw(14) << "draw mode";
+	for (Texture::TexelLayout layout : layouts)
+		cout << std::right << std::setw(16) << getLayoutName(layout);
+	cout << "   (ms per frame)" << endl;
+
+	for (int mi = 0; mi < 7; mi++) {
+		cout << std::left << std::setw(14) << drawModeNames[mi];
+		for (Texture::TexelLayout layout : layouts) {
+			texture.setTexelLayout(layout);
+			// every layout sees the same sequence of views
+			PPC ppc{ string(cameraFname) };
+			SWRenderTarget fb(ppc.getWidth(), ppc.getHeight());
+			Light light(true, ppc.getHfovDeg(), ppc.getWidth(), ppc.getHeight());
+			light.setAmbientK(0.4f);
+			light.setMatColor(V3(1.0f, 0.0f, 0.0f));
+			light.setPosition(ppc.getEyePoint());
+
+			drawMesh(drawModes[mi], fb, ppc, tMesh, light, texture); // warm up
+			Clock::time_point begin = Clock::now();
+			for (int fi = 0; fi < framesN; fi++) {
+				ppc.roll(360.0f / (float)framesN);
+				drawMesh(drawModes[mi], fb, ppc, tMesh, light, texture);
+			}
+			cout << std::right << std::fixed << std::setprecision(3) << std::setw(16)
+				<< getElapsedMs(begin) / framesN;
+		}
+		cout << endl;
+	}
+	return 0;
+}
@@ -7,135 +7,6 @@ using std::endl;
 
 // class member function definitions
 
-V3::V3(float x, float y, float z) {
-
-   xyz[0] = x;
-   xyz[1] = y;
-   xyz[2] = z;
-}
-
-V3::V3(unsigned int color)
-{
-	this->setFromColor(color);
-}
-
-V3::V3(const V3 &vectorToCopy) {
-
-   xyz[0] = vectorToCopy.xyz[0];
-   xyz[1] = vectorToCopy.xyz[1];
-   xyz[2] = vectorToCopy.xyz[2];
-}
-
-const V3& V3::operator=(const V3 &right) {
-
-   xyz[0] = right.xyz[0];
-   xyz[1] = right.xyz[1];
-   xyz[2] = right.xyz[2];
-   return *this;
-}
-
-float& V3::operator[](int i) {
-
-   return xyz[i];
-}
-
-V3 V3::operator+(const V3 &right) const {
-
-   return 
-      V3(xyz[0] + right.xyz[0],  // x
-         xyz[1] + right.xyz[1],  // y
-         xyz[2] + right.xyz[2]); // z
-}
-
-const V3& V3::operator+=(const V3 & right)
-{
-	xyz[0] += right.xyz[0]; // x
-	xyz[1] += right.xyz[1]; // y
-	xyz[2] += right.xyz[2]; // z
-	return *this;
-}
-
-V3 V3::operator-(const V3 &right) const {
-
-   return 
-      V3(xyz[0] - right.xyz[0],  // x
-         xyz[1] - right.xyz[1],  // y
-         xyz[2] - right.xyz[2]); // z
-}
-
-const V3& V3::operator-=(const V3 & right)
-{
-	xyz[0] -= right.xyz[0]; // x
-	xyz[1] -= right.xyz[1]; // y
-	xyz[2] -= right.xyz[2]; // z
-	return *this;
-}
-
-float V3::operator*(const V3 &right) const {
-
-   return 
-      xyz[0]*right.xyz[0] + 
-      xyz[1]*right.xyz[1] + 
-      xyz[2]*right.xyz[2]; // scalar
-}
-
-V3 V3::operator^(const V3 &right) const {
-
-   return
-      V3(xyz[1] * right.xyz[2] - xyz[2] * right.xyz[1],  // x
-         xyz[2] * right.xyz[0] - xyz[0] * right.xyz[2],  // y
-         xyz[0] * right.xyz[1] - xyz[1] * right.xyz[0]); // z
-}
-
-V3 V3::operator*(float scalar) const
-{
-	return V3(xyz[0] * scalar,
-		xyz[1] * scalar,
-		xyz[2] * scalar);
-}
-
-V3 V3::operator/(float scalar) const
-{
-	if (scalar != 0.0f) {
-		return V3(xyz[0] / scalar,
-			xyz[1] / scalar,
-			xyz[2] / scalar);
-	}
-	else {
-		cerr << "ERROR: Attempting to divide a vector by a zero scalar. Zero vector returned..." << endl;
-		return V3();
-	}
-		
-}
-
-void V3::normalize(void)
-{
-	float length = this->length();
-	if (length > 0) {
-		xyz[0] = xyz[0] / length;
-		xyz[1] = xyz[1] / length;
-		xyz[2] = xyz[2] / length;
-	}
-}
-
-V3 V3::getNormalized(void) const
-{
-	V3 result(*this);
-	result.normalize();
-	return result;
-}
-
-float V3::length(void) const
-{
-	// option A (faster)
-	//return sqrt(xyz[0] * xyz[0] +
-	//	xyz[1] * xyz[1] +
-	//	xyz[2] * xyz[2]);
-
-	// option B using dot product (elegant)
-	return sqrt((*this) * (*this));
-}
-
 V3 V3::thisPointInNewCoordSystem(
 	const V3 &origin,
 	const V3 &newBasisVectorX, 
@@ -268,65 +139,8 @@ void V3::rotateThisVectorAboutDirection(const V3 &direction, float theta) {
 	this->rotateThisPointAboutAxis(origin, direction, theta);
 }
 
-unsigned int V3::getColor() const {
-
-	unsigned int ret = 0xFF000000;
-
-	// clamping
-	const V3 &v = *this;
-	for (int i = 0; i < 3; i++) {
-		// clamping to [0,0f, 1.0f];
-		//float cf = v[i]; // Proffessor used this
-		float cf = xyz[i]; // I prefer this, allows me to use const qualifier
-		unsigned char cb;
-		cf = (cf < 0.0f) ? 0.0f : cf;
-		cf = (cf > 1.0f) ? 1.0f : cf;
-		cb = (unsigned char)(cf*255.0f + 0.5f);
-		((unsigned char*)&ret)[i] = cb;
-	}
-
-	return ret;
-}
-
-void V3::modulateBy(const V3 & color)
-{
-	this->xyz[0] *= color.xyz[0];
-	this->xyz[1] *= color.xyz[1];
-	this->xyz[2] *= color.xyz[2];
-}
-
-float V3::getComp(int i) const
-{
-	if (i >= 0 && i < 3) {
-		return xyz[i];
-	}
-	else {
-		cerr << "ERROR: Attempting to get invalid vector component. Zero returned..." << endl;
-		return 0.0f;
-	}
-}
-
-void V3::setFromColor(unsigned int color) {
-
-	float redf = (float)(((unsigned char*)(&color))[0]);
-	redf = redf / 255.0f;
-	float greenf = (float)(((unsigned char*)(&color))[1]);
-	greenf = greenf / 255.0f;
-	float bluef = (float)(((unsigned char*)(&color))[2]);
-	bluef = bluef / 255.0f;
-
-	xyz[0] = redf;
-	xyz[1] = greenf;
-	xyz[2] = bluef;
-}
-
 // friend function definitions
 
-V3 operator*(float scalarLeft, V3 &vectorRight) {
-
-	return (vectorRight * scalarLeft);
-}
-
 ostream& operator<<(ostream &output, const V3 &vector) {
 	// outputs a vector in the following format
 	// (x, y, z)
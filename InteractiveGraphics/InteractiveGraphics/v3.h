@@ -3,12 +3,14 @@
 #include<iostream>
 using std::ostream;
 using std::istream;
+#include <cmath>
 
 const float epsilonNormalizedError = 0.00001f;
 
 class V3 {
 	// this allows to overload the * for scalars that are to the left of vector
-	friend V3 operator*(float scalarLeft, V3 &vectorRight);
+	friend inline V3 operator*(float scalarLeft, const V3 &vectorRight)
+	{ return (vectorRight * scalarLeft); }
 	
 	// overloaded stram insertion operator; cannot be member function
 	// if we want to invoke it using cout << someVector
@@ -35,32 +37,34 @@ private:
 		const V3 &newBasisVectorY,
 		const V3 &newBasisVectorZ) const;
 public:
+	// All the small operators are defined inline below the class so that
+	// rasterizer inner loops compile down to plain float math instead of
+	// a function call per operation. Copying is left to the compiler so V3
+	// stays trivially copyable (and usable in constant expressions).
+
 	// constructors (builds a 0 vector by default)
-	V3(float x = 0, float y = 0, float z = 0);
+	constexpr V3(float x = 0, float y = 0, float z = 0) : xyz{ x, y, z } {}
 	// builds a color vector from unsigned int format color
-	V3(unsigned int color);
+	V3(unsigned int color) { setFromColor(color); }
 	//V3() {}; // No need for this since I'm specifying default values above
 
 	// copy constructor
-	// not really needed in this class since automatic shallow copies from
-	// compiler would be enough but it doesn't hurt to implement one as an exercise
-	// must receive a reference to prevent infinite recursions
-	V3(const V3 &vectorToCopy);
+	// compiler generated shallow copy is exactly what we want, and unlike a
+	// hand written one it keeps the class trivially copyable
+	V3(const V3 &vectorToCopy) = default;
 
 	//~V3(); // Default constructor is ok since class doesn't deal with dynamic data
 
 	// overloaded assignment operator
-	// Again I'm only implemeting this as exercise. For this class, autogenerated
-	// behavior by compiler is probably good enough.
-	// const return avoids (v1=v2)=v3.
-	// (That is bad not only because is weird syntax but also 
-	// because v1 = v2 and v1 = v3 but v2 is never set in that case)
+	// autogenerated behavior by compiler is good enough for this class.
 	// return reference does allow for cascaded assignments such as v1 = v2 = v3
 	// (v1.operator=(v2.operator(v3)) is allowed and good syntax
-	const V3& operator=(const V3 &right);
+	V3& operator=(const V3 &right) = default;
 
 	// access for read/write
-	float& operator[](int i);
+	float& operator[](int i) { return xyz[i]; }
+	// access for reads only (no bounds check unlike getComp)
+	const float& operator[](int i) const { return xyz[i]; }
 
 	// addition of two vectors
 	V3 operator+(const V3 &right) const;
@@ -90,9 +94,9 @@ public:
 	float length(void) const;
 
 	// access for exclusive reads (no writes)
-	float getX() const { return xyz[0]; }
-	float getY() const { return xyz[1]; }
-	float getZ() const { return xyz[2]; }
+	constexpr float getX() const { return xyz[0]; }
+	constexpr float getY() const { return xyz[1]; }
+	constexpr float getZ() const { return xyz[2]; }
 	float getComp(int i) const;
 
 	// set and get color using unsigned int format
@@ -106,4 +110,139 @@ public:
 	void rotateThisPointAboutAxis(const V3 &axisOrigin, const V3 &axisDirection, float theta);
 	// rotation of "this" vector about arbitrary direction
 	void rotateThisVectorAboutDirection(const V3 &direction, float theta);
-};
\ No newline at end of file
+};
+
+// inline member function definitions
+
+inline V3 V3::operator+(const V3 &right) const {
+
+	return
+		V3(xyz[0] + right.xyz[0],  // x
+			xyz[1] + right.xyz[1],  // y
+			xyz[2] + right.xyz[2]); // z
+}
+
+inline const V3& V3::operator+=(const V3 & right)
+{
+	xyz[0] += right.xyz[0]; // x
+	xyz[1] += right.xyz[1]; // y
+	xyz[2] += right.xyz[2]; // z
+	return *this;
+}
+
+inline V3 V3::operator-(const V3 &right) const {
+
+	return
+		V3(xyz[0] - right.xyz[0],  // x
+			xyz[1] - right.xyz[1],  // y
+			xyz[2] - right.xyz[2]); // z
+}
+
+inline const V3& V3::operator-=(const V3 & right)
+{
+	xyz[0] -= right.xyz[0]; // x
+	xyz[1] -= right.xyz[1]; // y
+	xyz[2] -= right.xyz[2]; // z
+	return *this;
+}
+
+inline float V3::operator*(const V3 &right) const {
+
+	return
+		xyz[0] * right.xyz[0] +
+		xyz[1] * right.xyz[1] +
+		xyz[2] * right.xyz[2]; // scalar
+}
+
+inline V3 V3::operator^(const V3 &right) const {
+
+	return
+		V3(xyz[1] * right.xyz[2] - xyz[2] * right.xyz[1],
+			xyz[2] * right.xyz[0] - xyz[0] * right.xyz[2],
+			xyz[0] * right.xyz[1] - xyz[1] * right.xyz[0]);
+}
+
+inline V3 V3::operator*(float scalar) const
+{
+	return V3(xyz[0] * scalar,
+		xyz[1] * scalar,
+		xyz[2] * scalar);
+}
+
+inline V3 V3::operator/(float scalar) const
+{
+	if (scalar != 0.0f) {
+		return V3(xyz[0] / scalar,
+			xyz[1] / scalar,
+			xyz[2] / scalar);
+	}
+	else {
+		std::cerr << "ERROR: Attempting to divide a vector by a zero scalar. Zero vector returned..." << std::endl;
+		return V3();
+	}
+}
+
+inline void V3::normalize(void)
+{
+	float length = this->length();
+	if (length > 0) {
+		xyz[0] = xyz[0] / length;
+		xyz[1] = xyz[1] / length;
+		xyz[2] = xyz[2] / length;
+	}
+}
+
+inline V3 V3::getNormalized(void) const
+{
+	V3 result(*this);
+	result.normalize();
+	return result;
+}
+
+inline float V3::length(void) const
+{
+	return sqrt((*this) * (*this));
+}
+
+inline float V3::getComp(int i) const
+{
+	if (i >= 0 && i < 3) {
+		return xyz[i];
+	}
+	else {
+		std::cerr << "ERROR: Attempting to get invalid vector component. Zero returned..." << std::endl;
+		return 0.0f;
+	}
+}
+
+inline unsigned int V3::getColor() const {
+
+	unsigned int ret = 0xFF000000;
+
+	// clamping
+	for (int i = 0; i < 3; i++) {
+		// clamping to [0,0f, 1.0f];
+		float cf = xyz[i];
+		unsigned char cb;
+		cf = (cf < 0.0f) ? 0.0f : cf;
+		cf = (cf > 1.0f) ? 1.0f : cf;
+		cb = (unsigned char)(cf*255.0f + 0.5f);
+		((unsigned char*)&ret)[i] = cb;
+	}
+
+	return ret;
+}
+
+inline void V3::setFromColor(unsigned int color) {
+
+	xyz[0] = (float)(((unsigned char*)(&color))[0]) / 255.0f;
+	xyz[1] = (float)(((unsigned char*)(&color))[1]) / 255.0f;
+	xyz[2] = (float)(((unsigned char*)(&color))[2]) / 255.0f;
+}
+
+inline void V3::modulateBy(const V3 & color)
+{
+	this->xyz[0] *= color.xyz[0];
+	this->xyz[1] *= color.xyz[1];
+	this->xyz[2] *= color.xyz[2];
+}
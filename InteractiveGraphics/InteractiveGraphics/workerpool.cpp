@@ -0,0 +1,102 @@
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(unsigned int threadsN) :
+	currentJob(nullptr),
+	currentJobsN(0),
+	nextJobIndex(0),
+	workersBusyN(0),
+	batchId(0),
+	isShuttingDown(false)
+{
+	if (threadsN == 0) {
+		threadsN = std::thread::hardware_concurrency();
+		if (threadsN == 0) // hardware_concurrency is allowed to not know
+			threadsN = 1;
+	}
+	// calling thread is the last worker
+	for (unsigned int i = 0; i + 1 < threadsN; i++) {
+		workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(poolMutex);
+		isShuttingDown = true;
+	}
+	workAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+void WorkerPool::runJobs(void)
+{
+	int jobIndex;
+	while ((jobIndex = nextJobIndex++) < currentJobsN) {
+		(*currentJob)(jobIndex);
+	}
+}
+
+void WorkerPool::workerLoop(void)
+{
+	unsigned int lastBatchId = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(poolMutex);
+			workAvailable.wait(lock, [&] {
+				return isShuttingDown || (batchId != lastBatchId); });
+			if (isShuttingDown)
+				return;
+			lastBatchId = batchId;
+		}
+
+		runJobs();
+
+		{
+			std::unique_lock<std::mutex> lock(poolMutex);
+			workersBusyN--;
+			if (workersBusyN == 0)
+				workDone.notify_one();
+		}
+	}
+}
+
+void WorkerPool::parallelFor(int jobsN, const std::function<void(int)> &job)
+{
+	if (jobsN <= 0)
+		return;
+
+	// not worth waking anybody up
+	if (workers.empty() || jobsN == 1) {
+		for (int i = 0; i < jobsN; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(poolMutex);
+		currentJob = &job;
+		currentJobsN = jobsN;
+		nextJobIndex = 0;
+		workersBusyN = (int)workers.size();
+		batchId++;
+	}
+	workAvailable.notify_all();
+
+	// help out instead of just waiting
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(poolMutex);
+	workDone.wait(lock, [&] { return workersBusyN == 0; });
+	currentJob = nullptr;
+	currentJobsN = 0;
+}
+
+WorkerPool & WorkerPool::getShared(void)
+{
+	// built on first use, destroyed at exit
+	static WorkerPool sharedPool;
+	return sharedPool;
+}
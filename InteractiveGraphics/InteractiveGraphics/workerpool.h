@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+using std::vector;
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Implements a small fixed size pool of worker threads. Work is handed out as
+// a range of job indices [0, jobsN) and parallelFor() blocks until all of
+// them are done, so callers can treat it like a plain (but faster) for loop.
+// The calling thread also takes jobs so no core sits idle waiting.
+class WorkerPool {
+private:
+	vector<std::thread> workers;
+	std::mutex poolMutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+
+	// current batch of work, only valid while parallelFor() is running
+	const std::function<void(int)> *currentJob;
+	int currentJobsN;
+	std::atomic<int> nextJobIndex; // next job index to be claimed
+	int workersBusyN; // workers that have not yet finished current batch
+	unsigned int batchId; // lets sleeping workers tell a new batch apart
+	bool isShuttingDown;
+
+	void workerLoop(void);
+	// claims and runs jobs of the current batch until there are none left
+	void runJobs(void);
+public:
+	// threadsN = 0 means use as many threads as hardware cores
+	WorkerPool(unsigned int threadsN = 0);
+	~WorkerPool();
+
+	// number of threads doing work including the calling thread
+	unsigned int getThreadsN(void) const { return (unsigned int)workers.size() + 1; }
+
+	// runs job(i) for every i in [0, jobsN) across the pool and returns
+	// when all of them have finished. Not reentrant.
+	void parallelFor(int jobsN, const std::function<void(int)> &job);
+
+	// process wide pool shared by the SW renderer
+	static WorkerPool &getShared(void);
+};